@@ -244,7 +244,11 @@ module stage2 (
 	output [7:0] addr
 );
 
+`ifdef SEQUENCE_ROM
+	SeqRom SeqRam (					// PC addr sequence built as a ROM by the assembler
+`else
 	SeqRam512x8 SeqRam (			// Stores PC addr sequence
+`endif
 		.din(8'b0),
 		.write_en(1'b0),
 		.waddr(9'b0),
@@ -276,7 +280,7 @@ reg WrEn;
 		PCNum2 = 8'hff;
 	end
 	
-	PCram256x16 PCram (			// Stores up to 256 PC's
+	PCram256x16 #(.addr_width(process_addr_width)) PCram (			// Stores up to 256 PC's
 		.din(PCwriteback_data),
 		.write_en(WrEn),
 		.waddr(PCwriteback_addr),
@@ -326,7 +330,11 @@ wire [31:0] instruction;
 
 	initial PCNum3 = 8'hff;
 	
-	InstructionRam InstRom (			// Stores up to 1024 instructions
+`ifdef INSTRUCTION_ROM
+	InstructionRom InstRom (			// Instructions built as a ROM by the assembler
+`else
+	InstructionRam #(.addr_width(instruction_addr_width)) InstRom (			// Stores up to 1024 instructions
+`endif
 		.din(32'b0),
 		.write_en(1'b0),
 		.waddr(9'b0),
@@ -384,7 +392,7 @@ wire [15:0] Rs2_i;
  		Rd = 16'hff;	
  	end
 
-	REGram256x16 Rs2RAM (			// Used for Rs2 indirection
+	REGram256x16 #(.addr_width(register_addr_width)) Rs2RAM (			// Used for Rs2 indirection
 		.din(Reg_data),
 		.write_en(WRen),
 		.waddr(Reg_data_addr[7:0]),
@@ -393,7 +401,7 @@ wire [15:0] Rs2_i;
 		.dout(Rs2_i)	
 	);
 
-	REGram256x16 RdRAM (				// Used for Rd indirection
+	REGram256x16 #(.addr_width(register_addr_width)) RdRAM (				// Used for Rd indirection
 		.din(Reg_data),
 		.write_en(WRen),
 		.waddr(Reg_data_addr[7:0]),
@@ -463,7 +471,7 @@ wire [7:0] dataRam;
 reg [7:0] Rs2_high;
 
 
-	REGram256x16 Rs1RAM (				// retrieves Rs1 register
+	REGram256x16 #(.addr_width(register_addr_width)) Rs1RAM (				// retrieves Rs1 register
 		.din(Reg_data),
 		.write_en(WRen),
 		.waddr(Reg_data_addr[7:0]),
@@ -472,7 +480,7 @@ reg [7:0] Rs2_high;
 		.dout(alu_a)	
 	);
 
-	REGram256x16 Rs2RAM (				// retrieves Rs2 register
+	REGram256x16 #(.addr_width(register_addr_width)) Rs2RAM (				// retrieves Rs2 register
 		.din(Reg_data),
 		.write_en(WRen),
 		.waddr(Reg_data_addr[7:0]),
@@ -481,7 +489,7 @@ reg [7:0] Rs2_high;
 		.dout(regRam)	
 	);
 
-	DataRam DataRAM (					// 1024x8 bytewide data ram
+	DataRam #(.addr_width(data_addr_width)) DataRAM (					// 1024x8 bytewide data ram
 		.din(Reg_data[7:0]),
 		.write_en(RamWRen),
 		.waddr( { !Reg_data_addr[9], Reg_data_addr[8:0] } ),	// Because data ram starts on a 512 byte boundry, we invert address bit 9. This makes the 
@@ -0,0 +1,184 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#include "machine.hpp"
+#include <chrono>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+/*
+Show a help screen in the terminal
+*/
+static void showHelp()
+{
+    std::cout << "Avalanche simulator" << std::endl;
+    std::cout << "Runs a program from the files written by the assembler, inst_data, reg_data, ram_data, pc_data and seq_data." << std::endl;
+    std::cout << "USAGE:" << std::endl;
+    std::cout << "avsim [-d <name>] [-p <name>] [-l <name>] [-r <name>] [-s <name>] [-n <cycles>] [-x <script>] [-c] [-q]" << std::endl;
+    std::cout << "OPTIONS:" << std::endl;
+    std::cout << "  -d <name> the name of the ram_data file" << std::endl;
+    std::cout << "  -p <name> the name of the inst_data file" << std::endl;
+    std::cout << "  -l <name> the name of the pc_data file" << std::endl;
+    std::cout << "  -r <name> the name of the reg_data file" << std::endl;
+    std::cout << "  -s <name> the name of the seq_data file" << std::endl;
+    std::cout << "  -n <cycles> The number of clock cycles to run for, 1000000 by default" << std::endl;
+    std::cout << "  -x <script> Read the I/O port stubs from <script>" << std::endl;
+    std::cout << "  -c Print how many times each instruction was run" << std::endl;
+    std::cout << "  -q Quiet mode, only print what the script asks for" << std::endl;
+    std::cout << "  -h This help text" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    std::string inst_file = "inst_data";
+    std::string reg_file = "reg_data";
+    std::string data_file = "ram_data";
+    std::string pc_file = "pc_data";
+    std::string seq_file = "seq_data";
+    std::string script;
+    long long cycles = 1000000;
+    bool counts = false;
+    bool quiet = false;
+
+    static struct option long_options[] = {
+        {"help", no_argument, 0, 'h'},
+        {"quiet", no_argument, 0, 'q'},
+        {"data-file", required_argument, 0, 'd'},
+        {"inst-file", required_argument, 0, 'p'},
+        {"pc-file", required_argument, 0, 'l'},
+        {"reg-file", required_argument, 0, 'r'},
+        {"seq-file", required_argument, 0, 's'},
+        {"cycles", required_argument, 0, 'n'},
+        {"script", required_argument, 0, 'x'},
+        {"counts", no_argument, 0, 'c'},
+        {0, 0, 0, 0}};
+
+    avsim::Machine m;
+    try
+    {
+        int c;
+        while ((c = getopt_long(argc, argv, "hqcd:p:l:r:s:n:x:", long_options, 0)) != -1)
+        {
+            switch (c)
+            {
+            case 'h':
+                showHelp();
+                return 0;
+            case 'q':
+                quiet = true;
+                break;
+            case 'c':
+                counts = true;
+                break;
+            case 'd':
+                data_file = optarg;
+                break;
+            case 'p':
+                inst_file = optarg;
+                break;
+            case 'l':
+                pc_file = optarg;
+                break;
+            case 'r':
+                reg_file = optarg;
+                break;
+            case 's':
+                seq_file = optarg;
+                break;
+            case 'n':
+                cycles = std::stoll(optarg);
+                break;
+            case 'x':
+                script = optarg;
+                break;
+            default:
+                throw std::invalid_argument("Invalid argument");
+            }
+        }
+        m.load(inst_file, reg_file, data_file, pc_file, seq_file);
+        if (script != "")
+            m.ports.load(script);
+    }
+    catch (std::exception &ex)
+    {
+        std::cout << ex.what() << std::endl;
+        std::cout << "Use avsim -h for help" << std::endl;
+        return 1;
+    }
+
+    // A process that comes round again before its PC is written back runs the same
+    // instruction again, as it would on the FPGA. The idle entry the assembler pads the
+    // sequence with is a jump to itself and may rerun
+    int length = m.sequence.size();
+    for (int p = 0; p < avsim::PC_COUNT; p++)
+    {
+        uint16_t pc = m.pcs[p] % avsim::INSTRUCTION_COUNT;
+        if (m.words[pc] == (0x12000000u | pc))
+            continue;
+        int last = -length;
+        int closest = length;
+        for (int i = 0; i < 2 * length; i++)
+        {
+            if (m.sequence[i % length] != p)
+                continue;
+            if (i - last < closest && i - last > 0)
+                closest = i - last;
+            last = i;
+        }
+        if (closest < avsim::PC_DELAY)
+            std::cout << "warning: process " << p << " comes round again after " << closest << " cycles, it reruns instructions until its PC is written back " << avsim::PC_DELAY << " cycles on" << std::endl;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    m.run(cycles);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (quiet)
+        return 0;
+
+    std::cout << "cycles " << m.cycle << ", sequence " << m.sequence.size() << ", ";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "simulated at " << (seconds > 0 ? m.cycle / seconds / 1e6 : 0) << " million cycles a second" << std::endl;
+    for (int p = 0; p < avsim::PC_COUNT; p++)
+    {
+        if (p >= m.processes && m.used[p] == 0)
+            continue;
+        std::cout << "  process " << p << " " << m.used[p] << " cycles, " << 100.0 * m.used[p] / m.cycle << "%, ";
+        std::cout << "pc " << std::hex << std::setfill('0') << std::setw(4) << m.pcs[p] << std::dec << std::setfill(' ') << std::endl;
+    }
+    for (auto it = m.ports.ports.begin(); it != m.ports.ports.end(); ++it)
+    {
+        avsim::Port &port = it->second;
+        std::cout << "  port " << std::hex << std::setfill('0') << std::setw(4) << it->first;
+        std::cout << " last written " << std::setw(4) << port.last << std::dec << std::setfill(' ');
+        std::cout << ", reads " << port.reads << ", writes " << port.writes << std::endl;
+    }
+    if (counts)
+    {
+        std::cout << "instruction counts" << std::endl;
+        for (int i = 0; i < avsim::INSTRUCTION_COUNT; i++)
+        {
+            if (m.executed[i] == 0)
+                continue;
+            std::cout << "  " << std::hex << std::setfill('0') << std::setw(4) << i << " " << std::setw(8) << m.words[i];
+            std::cout << std::dec << std::setfill(' ') << " " << m.executed[i] << std::endl;
+        }
+    }
+    return 0;
+}
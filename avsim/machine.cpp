@@ -0,0 +1,294 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#include "machine.hpp"
+#include <fstream>
+#include <stdexcept>
+
+namespace avsim
+{
+
+/*
+  Read a file of hex values in the form $readmemh takes, one value per word with an 
+  optional @address to move on to. Returns the number of values read.
+  */
+static int readHex(std::string name, std::vector<uint32_t> &values, int size)
+{
+    std::ifstream f(name);
+    if (!f.is_open())
+        throw std::invalid_argument("can not open " + name);
+    values.assign(size, 0);
+    int address = 0;
+    int count = 0;
+    std::string word;
+    while (f >> word)
+    {
+        if (word.compare(0, 2, "//") == 0)
+        {
+            std::getline(f, word);
+            continue;
+        }
+        try
+        {
+            if (word[0] == '@')
+            {
+                address = std::stoul(word.substr(1), 0, 16);
+                continue;
+            }
+            if (address >= size)
+                throw std::invalid_argument(name + " has more than " + std::to_string(size) + " entries");
+            values[address++] = std::stoul(word, 0, 16);
+            count = std::max(count, address);
+        }
+        catch (std::logic_error &ex)
+        {
+            throw std::invalid_argument(name + " has a bad entry -> " + word);
+        }
+    }
+    return count;
+}
+
+void Machine::load(std::string inst, std::string reg, std::string data, std::string pc, std::string seq)
+{
+    std::vector<uint32_t> v;
+    readHex(inst, v, INSTRUCTION_COUNT);
+    for (int i = 0; i < INSTRUCTION_COUNT; i++)
+        words[i] = v[i];
+    readHex(reg, v, REGISTER_COUNT);
+    for (int i = 0; i < REGISTER_COUNT; i++)
+        regs[i] = v[i];
+    readHex(data, v, DATA_SIZE);
+    for (int i = 0; i < DATA_SIZE; i++)
+        ram[i] = v[i];
+    processes = readHex(pc, v, PC_COUNT);
+    for (int i = 0; i < PC_COUNT; i++)
+        pcs[i] = v[i];
+    int length = readHex(seq, v, SEQUENCE_SIZE);
+    if (length == 0)
+        throw std::invalid_argument(seq + " is empty");
+    sequence.assign(v.begin(), v.begin() + length);
+    decode();
+}
+
+void Machine::decode()
+{
+    for (int i = 0; i < INSTRUCTION_COUNT; i++)
+    {
+        Decoded &d = decoded[i];
+        uint32_t w = words[i];
+        d.op = w >> 24;
+        d.rd = w >> 16;
+        d.rs1 = w >> 8;
+        d.rs2 = w;
+        d.imm = w;
+        int op = d.op;
+        if ((op & 0x38) == 0x18)
+        {
+            // The jumps that test registers and jump to the address in Rd
+            const uint8_t jumps[] = {KIND_JALR, KIND_JEQ, KIND_JNE, KIND_JLT, KIND_JGE, KIND_JBS, KIND_JBC, KIND_NOP};
+            d.kind = jumps[op & 0x07];
+        }
+        else if ((op & 0x18) == 0x00)
+            d.kind = (op & 0x0f) == 0 ? KIND_ADD : KIND_LOGIC;
+        else if ((op & 0x18) == 0x10)
+        {
+            if (op == 0x12)
+                d.kind = KIND_JAL;
+            else if (op == 0x94)
+                d.kind = KIND_JZ;
+            else if (op == 0x95)
+                d.kind = KIND_JNZ;
+            else
+                d.kind = op & 1 ? KIND_LDI : KIND_LINK;
+        }
+        else
+            d.kind = KIND_NOP;
+    }
+}
+
+/*
+  The data RAM starts at 0x200 and address bit 9 is turned over so the first byte of
+  the RAM file is at 0x200
+  */
+static inline int ramIndex(uint16_t address)
+{
+    return ((~address >> 9) & 1) << 9 | (address & 0x1ff);
+}
+
+uint16_t Machine::read(uint16_t address)
+{
+    switch (address >> 8)
+    {
+    case 0:
+        return regs[address & 0xff];
+    case 1:
+        return ports.read(address, cycle);
+    default:
+        return ram[ramIndex(address)];
+    }
+}
+
+void Machine::write(uint16_t address, uint16_t value, int process)
+{
+    switch (address >> 8)
+    {
+    case 0:
+        if (address & 0xff)
+            regs[address & 0xff] = value;
+        break;
+    case 1:
+        ports.write(address, value, cycle, process);
+        break;
+    default:
+        ram[ramIndex(address)] = value;
+        break;
+    }
+}
+
+void Machine::run(long long cycles)
+{
+    int length = sequence.size();
+    int slot = cycle % length;
+    for (long long end = cycle + cycles; cycle < end; cycle++)
+    {
+        // Writes come out of the end of the pipeline
+        Pending &written = pending[(cycle - DATA_DELAY) & 7];
+        if (written.write)
+        {
+            write(written.address, written.value, written.process);
+            written.write = false;
+        }
+        Pending &jumped = pending[(cycle - PC_DELAY) & 7];
+        if (jumped.process >= 0)
+        {
+            pcs[jumped.process] = jumped.pc;
+            jumped.process = -1;
+        }
+
+        int process = sequence[slot];
+        if (++slot == length)
+            slot = 0;
+        uint16_t pc = pcs[process];
+        int at = pc & (INSTRUCTION_COUNT - 1);
+        Decoded &d = decoded[at];
+        executed[at]++;
+        used[process]++;
+
+        Pending &p = pending[cycle & 7];
+        p.process = process;
+        p.pc = pc + 1;
+        uint16_t rd = d.op & 0x80 ? regs[d.rd] : d.rd;
+        uint16_t b;
+        switch (d.kind)
+        {
+        case KIND_ADD:
+            b = read(d.op & 0x40 ? regs[d.rs2] : d.rs2);
+            p.write = true;
+            p.address = rd;
+            p.value = regs[d.rs1] + b;
+            break;
+        case KIND_LOGIC:
+            b = read(d.op & 0x40 ? regs[d.rs2] : d.rs2);
+            switch (d.op & 0x0f)
+            {
+            case 2:
+                logic = regs[d.rs1] | b;
+                break;
+            case 3:
+                logic = regs[d.rs1] & b;
+                break;
+            case 4:
+                logic = regs[d.rs1] ^ b;
+                break;
+            case 5:
+                logic = regs[d.rs1] >> 1;
+                break;
+            case 6:
+                logic = b & ~(1 << (d.rs1 & 15));
+                break;
+            case 7:
+                logic = b | (1 << (d.rs1 & 15));
+                break;
+            }
+            p.write = true;
+            p.address = rd;
+            p.value = logic;
+            break;
+        case KIND_LDI:
+            p.write = true;
+            p.address = rd & 0xff;
+            p.value = d.imm;
+            break;
+        case KIND_LINK:
+            p.write = true;
+            p.address = rd & 0xff;
+            p.value = pc + 1;
+            break;
+        case KIND_JAL:
+            p.write = true;
+            p.address = rd;
+            p.value = pc + 1;
+            p.pc = d.imm;
+            break;
+        case KIND_JZ:
+            if (rd == 0)
+                p.pc = d.imm;
+            break;
+        case KIND_JNZ:
+            if (rd != 0)
+                p.pc = d.imm;
+            break;
+        case KIND_JALR:
+            if (d.op == 0x98)
+            {
+                p.write = true;
+                p.address = d.rs1;
+                p.value = pc + 1;
+            }
+            p.pc = rd;
+            break;
+        case KIND_JEQ:
+            if (regs[d.rs1] == read(d.op & 0x40 ? regs[d.rs2] : d.rs2))
+                p.pc = rd;
+            break;
+        case KIND_JNE:
+            if (regs[d.rs1] != read(d.op & 0x40 ? regs[d.rs2] : d.rs2))
+                p.pc = rd;
+            break;
+        case KIND_JLT:
+            if (regs[d.rs1] < read(d.op & 0x40 ? regs[d.rs2] : d.rs2))
+                p.pc = rd;
+            break;
+        case KIND_JGE:
+            if (regs[d.rs1] >= read(d.op & 0x40 ? regs[d.rs2] : d.rs2))
+                p.pc = rd;
+            break;
+        case KIND_JBS:
+            if ((read(d.op & 0x40 ? regs[d.rs2] : d.rs2) >> (d.rs1 & 15)) & 1)
+                p.pc = rd;
+            break;
+        case KIND_JBC:
+            if (!((read(d.op & 0x40 ? regs[d.rs2] : d.rs2) >> (d.rs1 & 15)) & 1))
+                p.pc = rd;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+} // namespace avsim
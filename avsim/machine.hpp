@@ -0,0 +1,153 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#ifndef MACHINE_HPP
+#define MACHINE_HPP
+
+#include "ports.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace avsim
+{
+
+/*
+Sizes of the memories of the processor
+*/
+const int INSTRUCTION_COUNT = 1024;
+const int REGISTER_COUNT = 256;
+const int PC_COUNT = 256;
+const int DATA_SIZE = 1024;
+const int SEQUENCE_SIZE = 512;
+
+/*
+How many cycles after it is fetched an instruction's writes are seen. Registers and 
+data RAM are written back in the last stage of the pipeline, three cycles after the
+next instructions have started to read them. A process's PC is read in the third stage
+so the next instruction of the process only gets the new PC six cycles on.
+*/
+const int DATA_DELAY = 3;
+const int PC_DELAY = 6;
+
+/*
+The instructions, predecoded so the simulator only does the work each one needs
+*/
+enum Kind
+{
+  KIND_ADD,
+  KIND_LOGIC,
+  KIND_LDI,
+  KIND_LINK,
+  KIND_JAL,
+  KIND_JZ,
+  KIND_JNZ,
+  KIND_JALR,
+  KIND_JEQ,
+  KIND_JNE,
+  KIND_JLT,
+  KIND_JGE,
+  KIND_JBS,
+  KIND_JBC,
+  KIND_NOP
+};
+
+class Decoded
+{
+public:
+  uint8_t kind = KIND_NOP;
+  uint8_t op = 0;
+  uint8_t rd = 0;
+  uint8_t rs1 = 0;
+  uint8_t rs2 = 0;
+  uint16_t imm = 0;
+};
+
+/*
+A write waiting to come out of the end of the pipeline
+*/
+class Pending
+{
+public:
+  int process = -1;
+  uint16_t pc = 0;
+
+  /*
+  True when the instruction writes value to address, a register, port or data RAM 
+  address
+  */
+  bool write = false;
+  uint16_t address = 0;
+  uint16_t value = 0;
+};
+
+/*
+Machine
+
+The Avalanche processor. Each clock cycle the next entry of the sequence RAM picks the
+process whose instruction is run, as the hardware does.
+*/
+class Machine
+{
+public:
+  /*
+  Load the memories from the files written by the assembler. The sequence runs for as 
+  many entries as the sequence file has.
+
+  Throws std::invalid_argument if a file can not be read.
+  */
+  void load(std::string inst, std::string reg, std::string data, std::string pc, std::string seq);
+
+  /*
+  Run for a number of clock cycles
+  */
+  void run(long long cycles);
+
+  Ports ports;
+
+  uint16_t regs[REGISTER_COUNT] = {};
+  uint8_t ram[DATA_SIZE] = {};
+  uint16_t pcs[PC_COUNT] = {};
+  uint32_t words[INSTRUCTION_COUNT] = {};
+  std::vector<uint8_t> sequence;
+
+  /*
+  Number of processes given in the pc file
+  */
+  int processes = 0;
+
+  long long cycle = 0;
+
+  /*
+  How many times each instruction has been run and how many cycles each process has had
+  */
+  std::vector<long long> executed = std::vector<long long>(INSTRUCTION_COUNT, 0);
+  std::vector<long long> used = std::vector<long long>(PC_COUNT, 0);
+
+private:
+  Decoded decoded[INSTRUCTION_COUNT];
+  Pending pending[8];
+  uint16_t logic = 0;
+
+  void decode();
+  uint16_t read(uint16_t address);
+  void write(uint16_t address, uint16_t value, int process);
+};
+
+} // namespace avsim
+
+#endif
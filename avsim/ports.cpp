@@ -0,0 +1,125 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#include "ports.hpp"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace avsim
+{
+
+/*
+  Read a number written in decimal or, with 0x in front, in hex
+  */
+static long long number(std::istringstream &in, std::string what, int line)
+{
+    std::string s;
+    if (!(in >> s))
+        throw std::invalid_argument("line " + std::to_string(line) + " expected " + what);
+    try
+    {
+        std::size_t used = 0;
+        long long v = std::stoll(s, &used, 0);
+        if (used == s.size())
+            return v;
+    }
+    catch (std::exception &ex)
+    {
+    }
+    throw std::invalid_argument("line " + std::to_string(line) + " expected " + what + " but found -> " + s);
+}
+
+void Ports::load(std::string name)
+{
+    std::ifstream f(name);
+    if (!f.is_open())
+        throw std::invalid_argument("can not open the script " + name);
+
+    std::string text;
+    int line = 0;
+    while (std::getline(f, text))
+    {
+        line++;
+        std::size_t comment = text.find(';');
+        if (comment != std::string::npos)
+            text.erase(comment);
+        std::istringstream in(text);
+        std::string command;
+        if (!(in >> command))
+            continue;
+
+        if (command == "in")
+        {
+            Port &p = ports[number(in, "a port", line)];
+            do
+                p.values.push_back(number(in, "a value", line));
+            while (!(in >> std::ws).eof());
+        }
+        else if (command == "at")
+        {
+            long long cycle = number(in, "a cycle", line);
+            Port &p = ports[number(in, "a port", line)];
+            p.changes[cycle] = number(in, "a value", line);
+        }
+        else if (command == "watch")
+            ports[number(in, "a port", line)].watch = true;
+        else
+            throw std::invalid_argument("line " + std::to_string(line) + " unknown command -> " + command);
+    }
+}
+
+uint16_t Ports::read(int address, long long cycle)
+{
+    auto it = ports.find(address);
+    if (it == ports.end())
+        return 0;
+    Port &p = it->second;
+    p.reads++;
+    if (!p.changes.empty() && p.changes.begin()->first <= cycle)
+    {
+        // A change that is due replaces whatever the port was returning
+        auto c = p.changes.upper_bound(cycle);
+        --c;
+        p.values.assign(1, c->second);
+        p.next = 0;
+        p.changes.erase(p.changes.begin(), ++c);
+    }
+    if (p.values.empty())
+        return 0;
+    uint16_t v = p.values[p.next];
+    if (p.next + 1 < p.values.size())
+        p.next++;
+    return v;
+}
+
+void Ports::write(int address, uint16_t value, long long cycle, int process)
+{
+    Port &p = ports[address];
+    p.writes++;
+    p.last = value;
+    if (p.watch)
+    {
+        std::cout << "cycle " << cycle << " process " << process << " wrote ";
+        std::cout << std::hex << std::setfill('0') << std::setw(4) << value << " to port " << std::setw(4) << address;
+        std::cout << std::dec << std::setfill(' ') << std::endl;
+    }
+}
+
+} // namespace avsim
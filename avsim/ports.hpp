@@ -0,0 +1,86 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#ifndef PORTS_HPP
+#define PORTS_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace avsim
+{
+
+/*
+Port
+
+A memory mapped I/O port, 0x100 to 0x1ff, as seen by the simulated program
+*/
+class Port
+{
+public:
+  /*
+  The values reads return in turn, the last one is returned from then on
+  */
+  std::vector<uint16_t> values;
+  std::size_t next = 0;
+
+  /*
+  Values the port changes to at a given cycle, set with at in the script
+  */
+  std::map<long long, uint16_t> changes;
+
+  /*
+  Print every write to the port
+  */
+  bool watch = false;
+
+  long long reads = 0;
+  long long writes = 0;
+  uint16_t last = 0;
+};
+
+/*
+Ports
+
+The I/O stubs the program talks to. A port that is not in the script reads as 0 and 
+keeps the last value written to it.
+*/
+class Ports
+{
+public:
+  std::map<int, Port> ports;
+
+  /*
+  Read a script of stubs, one per line, a ; starts a comment.
+
+  in PORT VALUE...        reads of PORT return each VALUE in turn, then the last one
+  at CYCLE PORT VALUE     reads of PORT return VALUE from CYCLE on
+  watch PORT              print every write to PORT
+
+  Throws std::invalid_argument if the script can not be read.
+  */
+  void load(std::string name);
+
+  uint16_t read(int address, long long cycle);
+  void write(int address, uint16_t value, long long cycle, int process);
+};
+
+} // namespace avsim
+
+#endif
@@ -0,0 +1,247 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#include "allocator.hpp"
+#include "dataflow.hpp"
+#include "program.hpp"
+#include "data.hpp"
+#include <algorithm>
+#include <map>
+#include <iostream>
+
+namespace allocator
+{
+
+std::vector<Pressure> report;
+
+/*
+  jbs and jbc take a bit number in place of Rs1
+  */
+static bool isBitJump(int op)
+{
+    return program::isRegisterJump(op) && ((op & 0x07) == 0x05 || (op & 0x07) == 0x06);
+}
+
+/*
+  Change the registers named by the node that are in the map to the registers they map to
+  */
+static void rename(program::Node &n, std::map<int, int> &to)
+{
+    auto swap = [&](int &field) {
+        auto t = to.find(field);
+        if (t != to.end())
+            field = t->second;
+    };
+    if (program::isALU(n.op))
+    {
+        swap(n.rd);
+        if (!program::isBitOp(n.op))
+            swap(n.rs1);
+        swap(n.rs2);
+    }
+    else if (program::isLDI(n.op) || program::isJAL(n.op) || program::isJZ(n.op))
+    {
+        swap(n.rd);
+    }
+    else if (program::isRegisterJump(n.op))
+    {
+        swap(n.rd);
+        if (!isBitJump(n.op))
+            swap(n.rs1);
+        swap(n.rs2);
+    }
+}
+
+/*
+  Work out which of the registers in mask are live before and after each node of the 
+  process. A jump to somewhere that is not known may go to any place that can be 
+  reached from somewhere that is not known, so it keeps whatever is live at those.
+  */
+static void liveness(dataflow::Analysis &a, dataflow::Registers mask, std::vector<dataflow::Registers> &live_in, std::vector<dataflow::Registers> &live_out)
+{
+    int count = a.code.nodes.size();
+    std::vector<dataflow::Registers> use(count), def(count);
+    for (int i = 0; i < count; i++)
+    {
+        use[i] = dataflow::namedUses(a.code.nodes[i]) & mask;
+        def[i] = dataflow::namedDefs(a.code.nodes[i]) & mask;
+    }
+    live_in.assign(count, dataflow::Registers());
+    live_out.assign(count, dataflow::Registers());
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        dataflow::Registers entry;
+        for (int i = 0; i < count; i++)
+        {
+            if (a.unknown_entry[i])
+                entry |= live_in[i];
+        }
+        for (int i = count - 1; i >= 0; i--)
+        {
+            dataflow::Registers out;
+            if (a.unknown_exit[i])
+                out = entry;
+            for (auto s = a.succ[i].begin(); s != a.succ[i].end(); ++s)
+            {
+                if (*s < count)
+                    out |= live_in[*s];
+            }
+            dataflow::Registers l = use[i] | (out & ~def[i]);
+            if (l != live_in[i] || out != live_out[i])
+            {
+                live_in[i] = l;
+                live_out[i] = out;
+                changed = true;
+            }
+        }
+    }
+}
+
+static void allocateProcess(program::Code &c)
+{
+    std::vector<VirtualRegister *> vregs;
+    dataflow::Registers mask;
+    for (auto v = data::data.vregs.begin(); v != data::data.vregs.end(); ++v)
+    {
+        if (v->process == c.process)
+        {
+            vregs.push_back(&*v);
+            mask.set(v->stand_in);
+        }
+    }
+    if (vregs.empty())
+        return;
+
+    dataflow::scan(c.process);
+    dataflow::Analysis a(c);
+    a.run();
+    std::vector<dataflow::Registers> live_in, live_out;
+    liveness(a, mask, live_in, live_out);
+
+    // Two registers conflict when one is written while the other is still needed
+    std::vector<dataflow::Registers> conflicts(dataflow::REGISTER_COUNT);
+    dataflow::Registers named;
+    int pressure = 0;
+    for (std::size_t i = 0; i < c.nodes.size(); i++)
+    {
+        named |= (dataflow::namedUses(c.nodes[i]) | dataflow::namedDefs(c.nodes[i])) & mask;
+        pressure = std::max(pressure, (int)std::max(live_in[i].count(), live_out[i].count()));
+        dataflow::Registers def = dataflow::namedDefs(c.nodes[i]) & mask;
+        for (int r = 0; r < dataflow::REGISTER_COUNT; r++)
+        {
+            if (!def[r])
+                continue;
+            conflicts[r] |= live_out[i];
+            for (int o = 0; o < dataflow::REGISTER_COUNT; o++)
+            {
+                if (live_out[i][o])
+                    conflicts[o].set(r);
+            }
+        }
+    }
+    // Registers read before they are written all hold something when the process starts
+    if (!c.nodes.empty())
+    {
+        for (int r = 0; r < dataflow::REGISTER_COUNT; r++)
+        {
+            if (live_in[0][r])
+                conflicts[r] |= live_in[0];
+        }
+    }
+
+    // Give each register the first colour that none of the registers it conflicts with have
+    std::map<int, int> colour;
+    int colours = 0;
+    for (auto v = vregs.begin(); v != vregs.end(); ++v)
+    {
+        int r = (*v)->stand_in;
+        if (!named[r])
+            continue;
+        std::vector<bool> taken(colours + 1, false);
+        for (auto o = colour.begin(); o != colour.end(); ++o)
+        {
+            if (o->first != r && conflicts[r][o->first])
+                taken[o->second] = true;
+        }
+        int k = std::find(taken.begin(), taken.end(), false) - taken.begin();
+        colour[r] = k;
+        colours = std::max(colours, k + 1);
+    }
+
+    int base = data::state.register_count;
+    for (int k = 0; k < colours; k++)
+        data::data.addRegister("0000", c.process);
+    data::state.register_count += colours;
+
+    std::map<int, int> to;
+    for (auto k = colour.begin(); k != colour.end(); ++k)
+        to[k->first] = base + k->second;
+    for (auto n = c.nodes.begin(); n != c.nodes.end(); ++n)
+        rename(*n, to);
+
+    for (auto v = vregs.begin(); v != vregs.end(); ++v)
+    {
+        auto t = to.find((*v)->stand_in);
+        if (t != to.end())
+            data::data.log((*v)->line_number, t->second, "0000", (*v)->line);
+    }
+
+    Pressure p;
+    p.process = c.name;
+    p.vregs = vregs.size();
+    p.registers = colours;
+    p.pressure = pressure;
+    report.push_back(p);
+}
+
+void allocate()
+{
+    report.clear();
+    if (data::data.vregs.empty())
+        return;
+
+    int lowest = VREG_STAND_IN_TOP;
+    for (auto v = data::data.vregs.begin(); v != data::data.vregs.end(); ++v)
+        lowest = std::min(lowest, v->stand_in);
+    if (data::state.register_count > lowest)
+    {
+        data::setError("Too many registers to place the .vreg registers (" + std::to_string(data::state.register_count) + "/" + std::to_string(lowest) + ")");
+        return;
+    }
+
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+        allocateProcess(*c);
+
+    if (data::state.register_count > dataflow::REGISTER_COUNT)
+    {
+        data::setError("Register file overflow (" + std::to_string(data::state.register_count) + "/" + std::to_string(dataflow::REGISTER_COUNT) + ")");
+    }
+}
+
+void printReport()
+{
+    for (auto p = report.begin(); p != report.end(); ++p)
+    {
+        std::cout << "process " << p->process << " vregs " << p->vregs << ", ";
+        std::cout << "registers " << p->registers << ", ";
+        std::cout << "pressure " << p->pressure << std::endl;
+    }
+}
+
+} // namespace allocator
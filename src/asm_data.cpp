@@ -15,62 +15,76 @@
  * 
  */
 #include "asm_data.hpp"
+#include "data.hpp"
 #include "process_map.hpp"
+#include "image.hpp"
+#include <algorithm>
 
 void AsmData::setListingLength(int len)
 {
     asm_listing.resize(len);
 }
 
-void AsmData::log(int ln, int location, std::string data, std::string line)
+void AsmData::log(int ln, int location, std::string data, std::string line, int kind)
 {
-    char fill = '.';
-    if ((ln % 2) == 0)
-    {
-        fill = ' ';
-    }
-
-    std::string location_line;
-    if (location == -1)
-    {
-        location_line = "";
-    }
-    else
-    {
-        location_line += stutils::int_to_hex((location >> 8) & 0xff);
-        location_line += stutils::int_to_hex(location & 0xff);
-    }
+    ListingEntry &e = asm_listing.at(ln - 1).main;
+    e.ln = ln;
+    e.location = location;
+    e.kind = kind;
+    e.data = data;
+    e.line = line;
+}
 
-    std::stringstream loc;
-    loc << std::left << std::setw(8) << std::setfill(fill)
-        << location_line;
+void AsmData::insertLog(int ln, int location, std::string data, std::string line, int kind)
+{
+    ListingEntry e;
+    e.ln = ln;
+    e.location = location;
+    e.kind = kind;
+    e.data = data;
+    e.line = line;
+    asm_listing.at(ln - 1).inserted.push_back(e);
+}
 
-    std::stringstream dat;
-    dat << std::left << std::setw(12) << std::setfill(fill)
-        << data;
+std::vector<ListingLine> &AsmData::getListing()
+{
+    return asm_listing;
+}
 
-    std::string l = loc.str() + dat.str() + " " + line + '\n';
+void AsmData::addRegister(std::string value, int process)
+{
+    reg_list.push_back(value);
+    reg_process.push_back(process);
+}
 
-    asm_listing.at((ln - 1) + insert_offset) = l;
+void AsmData::addData(std::string value, int process)
+{
+    data_list.push_back(value);
+    data_process.push_back(process);
 }
 
-void AsmData::insertLog(int ln, int location, std::string data, std::string line)
+std::string AsmData::formatListing(ListingEntry &e)
 {
+    if (e.ln == 0)
+    {
+        return "";
+    }
+
     char fill = '.';
-    if ((ln % 2) == 0)
+    if ((e.ln % 2) == 0)
     {
         fill = ' ';
     }
 
     std::string location_line;
-    if (location == -1)
+    if (e.location == -1)
     {
         location_line = "";
     }
     else
     {
-        location_line += stutils::int_to_hex((location >> 8) & 0xff);
-        location_line += stutils::int_to_hex(location & 0xff);
+        location_line += stutils::int_to_hex((e.location >> 8) & 0xff);
+        location_line += stutils::int_to_hex(e.location & 0xff);
     }
 
     std::stringstream loc;
@@ -79,99 +93,254 @@ void AsmData::insertLog(int ln, int location, std::string data, std::string line
 
     std::stringstream dat;
     dat << std::left << std::setw(12) << std::setfill(fill)
-        << data;
+        << e.data;
 
-    std::string l = loc.str() + dat.str() + " " + line + '\n';
-    asm_listing.insert((asm_listing.begin() + (ln - 1)) + insert_offset, l);
-    insert_offset++;
+    std::string columns = loc.str() + dat.str();
+    if (data::options.wcet)
+    {
+        std::stringstream cyc;
+        cyc << std::right << std::setw(12) << std::setfill(fill)
+            << e.cycles;
+        columns += cyc.str();
+    }
+    if (!data::options.profile_file.empty())
+    {
+        std::stringstream smp;
+        smp << std::right << std::setw(8) << std::setfill(fill)
+            << e.samples;
+        columns += smp.str();
+    }
+    return columns + " " + e.line + '\n';
 }
 
-void AsmData::createListingFile(std::string name)
+/*
+  Write a text file from the text made for it
+  */
+static void writeText(std::string name, std::string text)
 {
     std::ofstream f(name);
-    for (auto it = asm_listing.begin(); it != asm_listing.end(); ++it)
-    {
-        f << *it;
-    }
+    f << text;
     f.flush();
     f.close();
 }
 
-void AsmData::createProgramFile(std::string name)
+void AsmData::createListingFile(std::string name)
 {
-    std::ofstream f(name);
-    for (auto it = ins_list.begin(); it != ins_list.end(); ++it)
+    writeText(name, listingText());
+}
+
+std::string AsmData::listingText()
+{
+    std::stringstream f;
+    for (auto it = asm_listing.begin(); it != asm_listing.end(); ++it)
     {
-        f << *it + "\n";
+        for (auto e = it->inserted.begin(); e != it->inserted.end(); ++e)
+        {
+            f << formatListing(*e);
+        }
+        f << formatListing(it->main);
     }
-    f.flush();
-    f.close();
+    return f.str();
+}
+
+void AsmData::createProgramFile(std::string name)
+{
+    image::write(name, ins_list, 32, image::formatOf(image::IMAGE_INST));
 }
 
 void AsmData::createDataFile(std::string name)
 {
-    std::ofstream f(name);
-    for (auto it = data_list.begin(); it != data_list.end(); ++it)
-    {
-        f << *it + "\n";
-    }
-    f.flush();
-    f.close();
+    image::write(name, data_list, 8, image::formatOf(image::IMAGE_DATA));
 }
 
 void AsmData::createRegFile(std::string name)
 {
-    std::ofstream f(name);
-    for (auto it = reg_list.begin(); it != reg_list.end(); ++it)
-    {
-        f << *it + "\n";
-    }
-    f.flush();
-    f.close();
+    image::write(name, reg_list, 16, image::formatOf(image::IMAGE_REG));
 }
 
 void AsmData::createProcessFile(std::string name)
 {
-    std::ofstream f(name);
-    for (auto it = pc_list.begin(); it != pc_list.end(); ++it)
-    {
-        f << *it + "\n";
-    }
-    f.flush();
-    f.close();
+    image::write(name, pc_list, 16, image::formatOf(image::IMAGE_PC));
 }
 
 void AsmData::createSequenceFile(std::string name)
 {
-    int lcm = getLCMForSeqData();
-    int step = p_list.size(); // Number of top level processes
-    std::ofstream f(name);
-    for (auto itt = p_list.begin(); itt != p_list.end(); ++itt)
+    std::vector<int> seq = getSequence();
+    std::vector<std::string> words;
+    for (auto l = seq.begin(); l != seq.end(); ++l)
     {
-        ProcessData *pd = &*itt;
-        pd->buildLocationVector();
+        words.push_back(stutils::int_to_hex(*l));
+        sequenceCount += 1;
     }
-    for (int i = 0; i < lcm; i++)
+    image::write(name, words, 8, image::formatOf(image::IMAGE_SEQ));
+}
+
+/*
+  The number of address bits needed to hold count entries, at least 1
+  */
+static int addressWidth(std::size_t count)
+{
+    int width = 1;
+    while (((std::size_t)1 << width) < count)
+        width++;
+    return width;
+}
+
+/*
+  True when a memory of this many words is built as a ROM
+  */
+static bool isRom(std::size_t words)
+{
+    return data::options.rom_size > 0 && words > 0 && (int)words <= data::options.rom_size;
+}
+
+/*
+  Write a ROM module with the same ports as the RAM it stands in for. Each bank of 
+  ROM_BANK_SIZE words is a case statement that the synthesiser can build from logic,
+  and the bank the address is in is selected as the output is registered, in the 
+  same way as the read of a block RAM.
+  */
+static void writeRom(std::stringstream &f, std::string module, std::vector<std::string> &words, int data_width)
+{
+    int width = addressWidth(words.size());
+    int bank_width = std::min(width, addressWidth(ROM_BANK_SIZE));
+    int banks = (words.size() + ROM_BANK_SIZE - 1) / ROM_BANK_SIZE;
+    int digits = (bank_width + 3) / 4;
+    std::string bank_address = bank_width == width ? "raddr" : "raddr[" + std::to_string(bank_width - 1) + ":0]";
+
+    f << "module " << module << " (din, write_en, waddr, raddr, clk, dout);\n";
+    f << "\tparameter addr_width = " << width << ";\n";
+    f << "\tparameter data_width = " << data_width << ";\n";
+    f << "\tinput [addr_width-1:0] waddr, raddr;\n";
+    f << "\tinput [data_width-1:0] din;\n";
+    f << "\tinput write_en, clk;\n";
+    f << "\toutput reg [data_width-1:0] dout;\n";
+    f << "\n";
+    for (int b = 0; b < banks; b++)
+        f << "\treg [data_width-1:0] bank" << b << ";\n";
+
+    for (int b = 0; b < banks; b++)
     {
-        for (auto itt = p_list.begin(); itt != p_list.end(); ++itt)
+        f << "\n";
+        f << "\talways @(*) // Bank " << b << ".\n";
+        f << "\tbegin\n";
+        f << "\t\tcase (" << bank_address << ")\n";
+        for (int i = b * ROM_BANK_SIZE; i < (int)words.size() && i < (b + 1) * ROM_BANK_SIZE; i++)
         {
-            ProcessData *pd = &*itt;
-            f << pd->getNextLocationOutput() + "\n";
-            sequenceCount +=1;
+            std::stringstream a;
+            a << std::hex << std::setw(digits) << std::setfill('0') << (i % ROM_BANK_SIZE);
+            f << "\t\t\t" << bank_width << "'h" << a.str() << ": bank" << b << " = " << data_width << "'h" << words[i] << ";\n";
         }
+        f << "\t\t\tdefault: bank" << b << " = " << data_width << "'h0;\n";
+        f << "\t\tendcase\n";
+        f << "\tend\n";
     }
-    f.flush();
-    f.close();
+
+    f << "\n";
+    f << "\talways @(posedge clk) // Read memory.\n";
+    f << "\tbegin\n";
+    if (banks == 1)
+        f << "\t\tdout <= bank0;\n";
+    else
+    {
+        f << "\t\tcase (raddr[addr_width-1:" << bank_width << "])\n";
+        for (int b = 0; b < banks; b++)
+            f << "\t\t\t" << b << ": dout <= bank" << b << ";\n";
+        f << "\t\t\tdefault: dout <= " << data_width << "'h0;\n";
+        f << "\t\tendcase\n";
+    }
+    f << "\tend\n";
+    f << "\n";
+    f << "endmodule\n";
+}
+
+void AsmData::createRomFile(std::string name)
+{
+    std::string text = romText();
+    if (!text.empty())
+        writeText(name, text);
+}
+
+std::string AsmData::romText()
+{
+    std::vector<std::string> sequence;
+    std::vector<int> seq = getSequence();
+    for (auto s = seq.begin(); s != seq.end(); ++s)
+        sequence.push_back(stutils::int_to_hex(*s));
+
+    bool instructions = isRom(ins_list.size());
+    if (!instructions && !isRom(sequence.size()))
+        return "";
+
+    std::stringstream f;
+    f << "// Case ROMs made by the assembler from the program.\n";
+    f << "// Do not change manually.\n";
+    if (instructions)
+    {
+        f << "\n";
+        writeRom(f, "InstructionRom", ins_list, 32);
+    }
+    if (isRom(sequence.size()))
+    {
+        f << "\n";
+        writeRom(f, "SeqRom", sequence, 8);
+    }
+    return f.str();
 }
 
 void AsmData::createConfigFile(std::string name)
 {
-    std::ofstream f(name);
+    writeText(name, configText());
+}
+
+std::string AsmData::configText()
+{
+    std::stringstream f;
 
     f << "// These are assembler maintained constants.\n";
     f << "// Do not change manually.\n";
     f << "\n";
-    f << "parameter sequence_count = " << getLCMForSeqData() * p_list.size() << ";";
-    f.flush();
-    f.close();
+    f << "parameter sequence_count = " << getSequenceLength() << ";\n";
+    f << "\n";
+    f << "// The memory used by the program and the address widths of the smallest memories it fits in\n";
+    f << "parameter instruction_count = " << ins_list.size() << ";\n";
+    f << "parameter instruction_addr_width = " << addressWidth(ins_list.size()) << ";\n";
+    f << "parameter register_count = " << reg_list.size() << ";\n";
+    f << "parameter register_addr_width = " << addressWidth(reg_list.size()) << ";\n";
+    f << "parameter data_count = " << data_list.size() << ";\n";
+    f << "parameter data_addr_width = " << addressWidth(data_list.size()) << ";\n";
+    f << "parameter process_count = " << pc_list.size() << ";\n";
+    f << "parameter process_addr_width = " << addressWidth(pc_list.size()) << ";\n";
+
+    // The number of parts of each split process, in the order they were declared
+    std::vector<std::pair<std::string, int>> splits;
+    for (auto p = process_names.begin(); p != process_names.end(); ++p)
+    {
+        if (p->find('.') == std::string::npos)
+            continue;
+        std::string top = stutils::getTopProcessFromSplit(*p);
+        auto s = std::find_if(splits.begin(), splits.end(), [&top](const std::pair<std::string, int> &s) {
+            return s.first == top;
+        });
+        if (s == splits.end())
+            splits.push_back(std::make_pair(top, 1));
+        else
+            s->second++;
+    }
+    for (auto s = splits.begin(); s != splits.end(); ++s)
+        f << "parameter split_count_" << s->first << " = " << s->second << ";\n";
+
+    bool instructions = isRom(ins_list.size());
+    bool sequence = isRom(getSequence().size());
+    if (instructions || sequence)
+    {
+        f << "\n";
+        f << "// Memories built as case ROMs in rom.v instead of being loaded from their data files\n";
+        if (instructions)
+            f << "`define INSTRUCTION_ROM\n";
+        if (sequence)
+            f << "`define SEQUENCE_ROM\n";
+        f << "`include \"rom.v\"\n";
+    }
+    return f.str();
 }
@@ -20,21 +20,78 @@
 #include "macro.hpp"
 #include "options.hpp"
 #include "data_type.hpp"
+#include "num_utils.hpp"
 #include "process_map.hpp"
+#include "optimise.hpp"
+#include "loops.hpp"
+#include "inliner.hpp"
+#include "allocator.hpp"
+#include "overlay.hpp"
+#include "program.hpp"
+#include "pin.hpp"
+#include "profile.hpp"
+#include "usage.hpp"
+#include "wcet.hpp"
 #include <iostream>
 
 int Assemble::go()
 {
     preprocess();
+    if (data::state.error)
+        return data::state.error;
+    overlay::layout();
     if (data::state.error)
         return data::state.error;
     assemble();
     if (data::state.error)
         return data::state.error;
-    if ((getLCMForSeqData() * p_list.size()) > 511)
+    bool inline_calls = data::options.inline_size > 0 || program::hasHint(INLINE);
+    bool unroll = data::options.unroll_budget > 0 || program::hasHint(UNROLL);
+    bool vregs = !data::data.vregs.empty();
+    if (data::options.optimise || data::options.hoist || unroll || inline_calls || vregs)
+    {
+        program::load();
+        if (vregs)
+            allocator::allocate();
+        if (data::state.error)
+            return data::state.error;
+        if (inline_calls)
+            inliner::inlineCalls();
+        if (unroll)
+            loops::unroll();
+        if (data::options.hoist)
+            loops::hoist();
+        if (data::options.optimise)
+            optimise::optimise();
+        program::store();
+    }
+    if (!data::options.pin_file.empty() && !data::state.error)
     {
-        data::setError("Sequence ram overflow (" + std::to_string(getLCMForSeqData() * p_list.size()) + "/511)");
+        program::load();
+        pin::layout();
     }
+    if (getSequenceLength() > 511)
+    {
+        int exact = getSequenceLength();
+        if (data::options.sequence_tolerance <= 0)
+            data::setError("Sequence ram overflow (" + std::to_string(exact) + "/511)");
+        else if (!buildApproximateSequence(data::options.sequence_tolerance, 511))
+            data::setError("Sequence ram overflow (" + std::to_string(exact) + "/511), no shorter sequence is within " + std::to_string(data::options.sequence_tolerance) + "%");
+    }
+    else if (!spaceSequence(511))
+        data::setError("Sequence ram overflow, the process weights can not be met with every process coming round at most once every " + std::to_string(SEQUENCE_MIN_GAP) + " slots in 511 entries");
+    usage::check();
+    if (data::options.min_jitter && !data::state.error)
+        smoothSequence();
+    if (data::options.wcet && !data::state.error)
+    {
+        program::load();
+        wcet::analyse();
+    }
+    if (!data::options.profile_file.empty() && !data::state.error)
+        profile::load(data::options.profile_file);
+    if (sequenceHasIdle() && !data::state.error)
+        addIdleProcess();
     return 0;
 }
 
@@ -105,14 +162,28 @@ void Assemble::preprocessLine(void)
     case REGISTER:
         doSymbol(REGISTER);
         break;
+    case VREG:
+        doSymbol(VREG);
+        break;
+    case LOCAL:
+        doSymbol(LOCAL);
+        break;
     case CONST:
         doSymbol(CONST);
         break;
     case DATA:
         doSymbol(DATA);
         break;
+    case RODATA:
+        doSymbol(RODATA);
+        break;
+    case FLAG:
+        doSymbol(FLAG);
+        break;
     case PROCESS:
         data::state.in_process = true;
+        data::state.flag_bit = 16; // Flags local to the process get registers of their own
+        data::state.vreg_count = 0;
         t2 = data::token_list.expect(data::state.error, {IDENTIFIER, SPLIT_IDENTIFIER});
         try
         {
@@ -125,11 +196,16 @@ void Assemble::preprocessLine(void)
         data::state.process_name = t2.s_value + "_";
         if (data::state.error)
             return;
+        doWeight(t2.s_value);
         break;
     case ENDPROCESS:
         doEndProcess();
         break;
     case INSTRUCTION:
+        if (t.value == INSTRUCTION_JAL_VALUE)
+            overlay::addCall();
+        else if (t.value == INSTRUCTION_JALR_VALUE)
+            overlay::addReturn();
         data::state.prog_count++;
         break;
     case LABEL:
@@ -138,8 +214,15 @@ void Assemble::preprocessLine(void)
             preprocessLine();
         break;
     case MACRO:
+        if (t.s_value == MACRO_CALL)
+            overlay::addCall();
+        else if (t.s_value == MACRO_RETURN)
+            overlay::addReturn();
         data::state.prog_count += instructions::getLengthOfMacro(t.s_value);
         break;
+    case HINT:
+        doHint(t);
+        break;
     case NONE:
     default:
         data::setError("Unknown instruction --> " + t.s_value);
@@ -154,15 +237,19 @@ void Assemble::assembleLine(void)
     switch (t.type)
     {
     case REGISTER:
+    case VREG:
+    case LOCAL:
     case CONST:
     case DATA:
+    case RODATA:
+    case FLAG:
         break;
     case LABEL:
         if (data::token_list.hasNext())
             assembleLine(); // A label may well have an instruction on the same line
         else                // So we call preprocessLine again so we can catch it
         {
-            data::data.log(data::state.line_number, data::state.prog_count, "", data::state.line);
+            data::data.log(data::state.line_number, data::state.prog_count, "", data::state.line, LISTING_ADDRESS);
         }
         break;
     case PROCESS:
@@ -177,6 +264,8 @@ void Assemble::assembleLine(void)
     case MACRO:
         doMacro(t);
         break;
+    case HINT:
+        break;
     case NONE:
     default:
         data::setError("Unknown instruction --> " + t.s_value);
@@ -220,13 +309,51 @@ void Assemble::doProcess(void)
     data::state.in_process = true;
     data::state.process_name = t.s_value + "_";
     data::data.pc_list.push_back(stutils::int_to_hex((data::state.prog_count >> 8) & 0xff) + stutils::int_to_hex(data::state.prog_count & 0xff));
+    data::data.process_names.push_back(t.s_value);
 
-    if (data::token_list.hasNext())
+    if (data::token_list.hasNext() && data::token_list.getNext().s_value.compare(0, WEIGHT.size(), WEIGHT) != 0)
     {
         data::setError("Unexpected instruction found after process name.");
         return;
     }
-    data::data.log(data::state.line_number, data::state.prog_count, "", data::state.line);
+    data::data.log(data::state.line_number, data::state.prog_count, "", data::state.line, LISTING_PROCESS);
+}
+
+void Assemble::doWeight(std::string &name)
+{
+    if (!data::token_list.hasNext())
+        return;
+
+    Token t = data::token_list.getNext();
+    if (t.s_value.compare(0, WEIGHT.size(), WEIGHT) != 0)
+    {
+        data::setError("Unexpected instruction found after process name.");
+        return;
+    }
+
+    Token v(t.s_value.substr(WEIGHT.size()));
+    int weight = numutils::getIValue(v);
+    if (data::state.error)
+    {
+        data::setError("Invalid process weight -> " + t.s_value);
+        return;
+    }
+    if (weight < 1)
+    {
+        data::setError("Process weight must be 1 or more but is value -> " + std::to_string(weight));
+        return;
+    }
+
+    if (!instructions::checkForMore())
+        return;
+
+    ProcessData *pd = getProcessWithTopName(name);
+    if (pd->weight != 0 && pd->weight != weight)
+    {
+        data::setError("A different weight has already been given to " + pd->getTopName());
+        return;
+    }
+    pd->weight = weight;
 }
 
 void Assemble::doEndProcess(void)
@@ -238,6 +365,7 @@ void Assemble::doEndProcess(void)
     }
     data::state.in_process = false;
     data::state.process_name = "";
+    data::state.flag_bit = 16;
     if (data::token_list.hasNext())
     {
         data::setError("Unexpected instruction found after endprocess.");
@@ -246,6 +374,41 @@ void Assemble::doEndProcess(void)
     data::data.log(data::state.line_number, -1, "", data::state.line);
 }
 
+void Assemble::doHint(Token &hint)
+{
+    if (!data::state.in_process)
+    {
+        data::setError(hint.s_value + " can only be used inside a process.");
+        return;
+    }
+
+    Hint h;
+    h.name = hint.s_value;
+    h.line_number = data::state.line_number;
+    h.process = data::data.process_count - 1;
+    if (h.name == LOOPBOUND && !data::token_list.hasNext())
+    {
+        data::setError(hint.s_value + " needs the most times the loop that follows it can go round");
+        return;
+    }
+    if ((h.name == UNROLL || h.name == LOOPBOUND) && data::token_list.hasNext())
+    {
+        h.value = instructions::getImmValue();
+        if (data::state.error)
+            return;
+        if (h.value < 1)
+        {
+            data::setError(hint.s_value + " value must be 1 or more but is value -> " + std::to_string(h.value));
+            return;
+        }
+    }
+    if (!instructions::checkForMore())
+        return;
+
+    data::data.hints.push_back(h);
+    data::data.log(data::state.line_number, -1, "", data::state.line);
+}
+
 void Assemble::doSymbol(int type)
 {
     switch (type)
@@ -253,12 +416,24 @@ void Assemble::doSymbol(int type)
     case REGISTER:
         data_type::createReg();
         break;
+    case VREG:
+        data_type::createVreg();
+        break;
+    case LOCAL:
+        data_type::createLocal();
+        break;
     case DATA:
         data_type::createData();
         break;
+    case RODATA:
+        data_type::createData(true);
+        break;
     case CONST:
         data_type::createConst();
         break;
+    case FLAG:
+        data_type::createFlag();
+        break;
     }
 }
 
@@ -266,8 +441,7 @@ void Assemble::doInstruction(Token &ins)
 {
     if (ins.s_value == INSTRUCTION_NOP)
     {
-        data::data.ins_list.push_back("00000000");
-        data::data.log(data::state.line_number, data::state.prog_count++, "00000000", data::state.line);
+        data::log("00000000");
         return;
     }
 
@@ -334,6 +508,7 @@ void Assemble::doInstruction(Token &ins)
 
 void Assemble::doMacro(Token &t)
 {
+    data::data.macro_lines[data::state.line_number] = t.s_value;
     if (t.s_value == MACRO_CALL)
         instructions::macroCall();
     else if (t.s_value == MACRO_DJNZ)
@@ -376,4 +551,36 @@ void Assemble::doMacro(Token &t)
         instructions::macroSt();
     else if (t.s_value == MACRO_MOV)
         instructions::macroMov();
+    else if (t.s_value == MACRO_MUL || t.s_value == MACRO_DIV || t.s_value == MACRO_MOD)
+        instructions::macroArithmetic(t.s_value);
+    else if (t.s_value == MACRO_MEMCPY || t.s_value == MACRO_MEMSET)
+        instructions::macroBlock(t.s_value);
+    else if (t.s_value == MACRO_SWITCH)
+        instructions::macroSwitch();
+    else if (t.s_value == MACRO_SETF)
+        instructions::macroSetf(INSTRUCTION_SETB_VALUE);
+    else if (t.s_value == MACRO_CLRF)
+        instructions::macroSetf(INSTRUCTION_CLRB_VALUE);
+    else if (t.s_value == MACRO_JFS)
+        instructions::macroJfs(INSTRUCTION_JBSR_VALUE);
+    else if (t.s_value == MACRO_JFC)
+        instructions::macroJfs(INSTRUCTION_JBCR_VALUE);
+}
+
+void Assemble::addIdleProcess(void)
+{
+    int at = data::data.ins_list.size();
+    if (at >= data::options.imem_size)
+    {
+        data::setError("Instruction memory overflow, no room for the jump the idle slots of the sequence run");
+        return;
+    }
+    if (data::data.pc_list.size() >= 256)
+    {
+        data::setError("Too many processes, no pc_data entry left for the idle slots of the sequence");
+        return;
+    }
+    data::data.ins_list.push_back(stutils::int_to_hex(INSTRUCTION_JAL_VALUE) + stutils::int_to_hex(0) + stutils::int_to_hex((at >> 8) & 0xff) + stutils::int_to_hex(at & 0xff));
+    data::data.ins_info.push_back(InstructionInfo());
+    data::data.pc_list.push_back(stutils::int_to_hex((at >> 8) & 0xff) + stutils::int_to_hex(at & 0xff));
 }
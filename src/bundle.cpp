@@ -0,0 +1,229 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#include "bundle.hpp"
+#include "data.hpp"
+#include "image.hpp"
+#include "process_map.hpp"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+namespace bundle
+{
+
+static void put(std::vector<unsigned char> &b, unsigned long long value, int size)
+{
+    for (int i = 0; i < size; i++)
+        b.push_back((value >> (8 * i)) & 0xff);
+}
+
+static unsigned long long get(const std::vector<unsigned char> &b, std::size_t at, int size)
+{
+    unsigned long long value = 0;
+    for (int i = 0; i < size; i++)
+        value |= (unsigned long long)b[at + i] << (8 * i);
+    return value;
+}
+
+unsigned long long hash(const std::vector<unsigned char> &b, std::size_t at, std::size_t length)
+{
+    unsigned long long h = 0xcbf29ce484222325ULL;
+    for (std::size_t i = at; i < at + length; i++)
+    {
+        h ^= b[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static Section image(int type, std::string name, const std::vector<std::string> &words, int width)
+{
+    Section s;
+    s.type = type;
+    s.width = width;
+    s.name = name;
+    s.contents = image::toBinary(words, width);
+    return s;
+}
+
+static Section text(int type, std::string name, const std::string &t)
+{
+    Section s;
+    s.type = type;
+    s.name = name;
+    s.contents.assign(t.begin(), t.end());
+    return s;
+}
+
+bool write(std::string name, std::string listing)
+{
+    std::vector<std::string> seq;
+    std::vector<int> sequence = getSequence();
+    for (auto s = sequence.begin(); s != sequence.end(); ++s)
+        seq.push_back(stutils::int_to_hex(*s));
+
+    std::vector<Section> sections;
+    sections.push_back(image(SECTION_INST, data::options.inst_file, data::data.ins_list, 32));
+    sections.push_back(image(SECTION_DATA, data::options.data_file, data::data.data_list, 8));
+    sections.push_back(image(SECTION_PC, data::options.pc_file, data::data.pc_list, 16));
+    sections.push_back(image(SECTION_REG, data::options.reg_file, data::data.reg_list, 16));
+    sections.push_back(image(SECTION_SEQ, data::options.seq_file, seq, 8));
+
+    Section meta;
+    meta.type = SECTION_META;
+    meta.width = 32;
+    put(meta.contents, getSequenceLength(), 4);
+    put(meta.contents, data::data.ins_list.size(), 4);
+    put(meta.contents, data::data.reg_list.size(), 4);
+    put(meta.contents, data::data.data_list.size(), 4);
+    put(meta.contents, data::data.pc_list.size(), 4);
+    sections.push_back(meta);
+
+    sections.push_back(text(SECTION_CONFIG, "config.v", data::data.configText()));
+    std::string rom = data::data.romText();
+    if (!rom.empty())
+        sections.push_back(text(SECTION_ROM, "rom.v", rom));
+    sections.push_back(text(SECTION_LISTING, listing, data::data.listingText()));
+
+    std::vector<unsigned char> b(MAGIC.begin(), MAGIC.end());
+    put(b, VERSION, 4);
+    put(b, sections.size(), 4);
+    put(b, ALIGNMENT, 4);
+
+    std::size_t offset = HEADER_SIZE + sections.size() * INDEX_ENTRY_SIZE;
+    for (auto s = sections.begin(); s != sections.end(); ++s)
+    {
+        if (s->name.size() >= (std::size_t)NAME_SIZE)
+        {
+            std::cout << "The name " << s->name << " is too long to put in a bundle" << std::endl;
+            return false;
+        }
+        offset = (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        put(b, s->type, 4);
+        put(b, s->width, 4);
+        put(b, offset, 8);
+        put(b, s->contents.size(), 8);
+        put(b, hash(s->contents, 0, s->contents.size()), 8);
+        std::string padded = s->name;
+        padded.resize(NAME_SIZE, '\0');
+        b.insert(b.end(), padded.begin(), padded.end());
+        offset += s->contents.size();
+    }
+    for (auto s = sections.begin(); s != sections.end(); ++s)
+    {
+        b.resize((b.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, 0);
+        b.insert(b.end(), s->contents.begin(), s->contents.end());
+    }
+
+    std::ofstream f(name, std::ios::binary);
+    if (!f.is_open())
+    {
+        std::cout << "Failed to open file - " << name << std::endl;
+        return false;
+    }
+    f.write((const char *)b.data(), b.size());
+    f.close();
+    return true;
+}
+
+/*
+  Print why a bundle can not be read
+  */
+static bool bad(std::string name, std::string why)
+{
+    std::cout << "Bad bundle " << name << ", " << why << std::endl;
+    return false;
+}
+
+bool read(std::string name, std::vector<Section> &sections)
+{
+    std::ifstream f(name, std::ios::binary);
+    if (!f.is_open())
+    {
+        std::cout << "Failed to open file - " << name << std::endl;
+        return false;
+    }
+    std::vector<unsigned char> b((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    if (b.size() < (std::size_t)HEADER_SIZE || std::string(b.begin(), b.begin() + MAGIC.size()) != MAGIC)
+        return bad(name, "it is not an avasm bundle");
+    if (get(b, 4, 4) != (unsigned long long)VERSION)
+        return bad(name, "version " + std::to_string(get(b, 4, 4)) + " is not supported");
+    std::size_t count = get(b, 8, 4);
+    if (b.size() < HEADER_SIZE + count * INDEX_ENTRY_SIZE)
+        return bad(name, "the index is cut short");
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        std::size_t at = HEADER_SIZE + i * INDEX_ENTRY_SIZE;
+        Section s;
+        s.type = get(b, at, 4);
+        s.width = get(b, at + 4, 4);
+        unsigned long long offset = get(b, at + 8, 8);
+        unsigned long long length = get(b, at + 16, 8);
+        std::string padded(b.begin() + at + 32, b.begin() + at + 32 + NAME_SIZE);
+        s.name = padded.substr(0, padded.find('\0'));
+        if (offset > b.size() || length > b.size() - offset)
+            return bad(name, "section " + s.name + " is past the end of the file");
+        if (hash(b, offset, length) != get(b, at + 24, 8))
+            return bad(name, "section " + s.name + " does not match its hash");
+        if (s.type < SECTION_INST || s.type > SECTION_LISTING || (s.type != SECTION_META && s.name.empty()))
+            return bad(name, "section " + std::to_string(i) + " is not known");
+        if (s.width % 8 || (s.width && length % (s.width / 8)))
+            return bad(name, "section " + s.name + " is not a whole number of words");
+        s.contents.assign(b.begin() + offset, b.begin() + offset + length);
+        sections.push_back(s);
+    }
+    return true;
+}
+
+bool unbundle(std::string name, bool quiet)
+{
+    // Check every section before anything is written
+    std::vector<Section> sections;
+    if (!read(name, sections))
+        return false;
+
+    for (auto s = sections.begin(); s != sections.end(); ++s)
+    {
+        if (s->type == SECTION_META)
+        {
+            if (!quiet && s->contents.size() >= 20)
+            {
+                std::cout << "sequence " << get(s->contents, 0, 4) << ", instructions " << get(s->contents, 4, 4);
+                std::cout << ", registers " << get(s->contents, 8, 4) << ", data " << get(s->contents, 12, 4);
+                std::cout << ", processes " << get(s->contents, 16, 4) << std::endl;
+            }
+            continue;
+        }
+        if (s->width)
+            image::write(s->name, image::fromBinary(s->contents, s->width), s->width, image::FORMAT_HEX);
+        else
+        {
+            std::ofstream t(s->name, std::ios::binary);
+            t.write((const char *)s->contents.data(), s->contents.size());
+            t.close();
+        }
+        if (!quiet)
+            std::cout << "  " << s->name << " " << s->contents.size() << " bytes" << std::endl;
+    }
+    return true;
+}
+
+} // namespace bundle
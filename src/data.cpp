@@ -24,6 +24,7 @@ AsmData data;
 AssemblerState state;
 SymbolList symbol_list;
 TokenList token_list;
+Options options;
 
 void setError(std::string s)
 {
@@ -39,16 +40,30 @@ void printError()
     std::cout << "Build failed" << std::endl;
 }
 
-void log(std::string s)
+/*
+  Store the instruction and the information that goes with it
+  */
+static void addInstruction(std::string s, bool address, bool table = false)
 {
+    InstructionInfo info;
+    info.line_number = data::state.line_number;
+    info.process = data::data.pc_list.size() - 1;
+    info.address = address;
+    info.table = table;
     data::data.ins_list.push_back(s);
-    data::data.log(data::state.line_number, data::state.prog_count++, s, data::state.line);
+    data::data.ins_info.push_back(info);
 }
 
-void logMacro(std::string s)
+void log(std::string s, bool address)
 {
-    data::data.ins_list.push_back(s);
-    data::data.log(data::state.line_number, data::state.prog_count++, s, "<________");
+    addInstruction(s, address);
+    data::data.log(data::state.line_number, data::state.prog_count++, s, data::state.line, LISTING_INSTRUCTION);
+}
+
+void logMacro(std::string s, std::string line, bool address, bool table)
+{
+    addInstruction(s, address, table);
+    data::data.insertLog(data::state.line_number, data::state.prog_count++, s, line, LISTING_INSTRUCTION);
 }
 
 } // namespace data
\ No newline at end of file
@@ -164,7 +164,29 @@ void createConst(void)
     data::data.log(data::state.line_number, loc, line, data::state.line);
 }
 
-void createData(void)
+/*
+  Finds an earlier read only string that ends with s, returns the address of s 
+  within it or -1 if there is none. The terminating 0 is shared as well.
+  */
+static int findPooledString(const std::string &s)
+{
+    for (auto p = data::data.string_pool.begin(); p != data::data.string_pool.end(); ++p)
+    {
+        if (p->first.size() >= s.size() && p->first.compare(p->first.size() - s.size(), s.size(), s) == 0)
+            return p->second + int(p->first.size() - s.size());
+    }
+    return -1;
+}
+
+/*
+  The index of the process a declaration is in, -1 outside of a process
+  */
+static int declaringProcess()
+{
+    return data::state.in_process ? data::data.process_count - 1 : -1;
+}
+
+void createData(bool read_only)
 {
     Token iden;
     if (!getIdentifier(iden))
@@ -189,7 +211,7 @@ void createData(void)
             do
             {
                 line = stutils::int_to_hex(val & 0xff);
-                data::data.data_list.push_back(line);
+                data::data.addData(line, declaringProcess());
                 data::state.data_count++;
                 if (checkForMore()) // If there is an associated value grab it
                 {
@@ -212,7 +234,18 @@ void createData(void)
         return;
     }
 
-    data::state.data_count += size;
+    int pooled = -1;
+    if (read_only && t.type == STRING)
+    {
+        pooled = findPooledString(t.s_value);
+        if (pooled < 0)
+            data::data.string_pool.push_back(std::make_pair(t.s_value, location));
+        else
+            location = pooled;
+    }
+
+    if (pooled < 0)
+        data::state.data_count += size;
 
     std::string s = stutils::int_to_hex((val >> 8) & 0xff);
     s += stutils::int_to_hex(val & 0xff);
@@ -224,13 +257,13 @@ void createData(void)
     If this data is a string it will be fileld with the contents of the string
     If it is just a regular data value it will contain the set value
     */
-    for (int i = 0; i < size; i++)
+    for (int i = 0; i < size && pooled < 0; i++)
     {
         if (t.type == STRING)
         {
             int sval = int(t.s_value[i]);
             line = stutils::int_to_hex(sval & 0xff);
-            data::data.data_list.push_back(line);
+            data::data.addData(line, declaringProcess());
         }
         else
         {
@@ -242,7 +275,7 @@ void createData(void)
             {
                 line = "00";
             }
-            data::data.data_list.push_back(line);
+            data::data.addData(line, declaringProcess());
         }
     }
 
@@ -250,14 +283,14 @@ void createData(void)
     String types of data have a terminating 0.
     Put one last data entry in the listing to represent this
     */
-    if (t.type == STRING)
+    if (t.type == STRING && pooled < 0)
     {
-        data::data.data_list.push_back("00");
+        data::data.addData("00", declaringProcess());
         data::state.data_count++;
     }
 
     std::string name = data::state.process_name + iden.s_value;
-    int type = DATA;
+    int type = DATA; // Read only data is still data to the instructions that use it
 
     try
     {
@@ -332,7 +365,7 @@ void createReg(void)
 
     std::string line = stutils::int_to_hex((val >> 8) & 0xff);
     line += stutils::int_to_hex(val & 0xff);
-    data::data.reg_list.push_back(line);
+    data::data.addRegister(line, declaringProcess());
     data::data.log(data::state.line_number, location, line, data::state.line);
 
     try
@@ -345,4 +378,143 @@ void createReg(void)
     }
 }
 
+void createLocal(void)
+{
+    if (!data::state.in_process)
+    {
+        data::setError(".local can only be declared inside a process");
+        return;
+    }
+
+    Token routine;
+    if (!getIdentifier(routine))
+        return;
+
+    Token iden;
+    if (!getIdentifier(iden))
+        return;
+
+    LocalData l;
+    l.name = iden.s_value;
+    l.routine = routine.s_value;
+    l.process = data::state.process_name;
+    l.line = data::state.line;
+    l.line_number = data::state.line_number;
+
+    if (checkForMore())
+    {
+        Token t = data::token_list.expect(data::state.error, {SIZE});
+        if (data::state.error)
+        {
+            data::setError(".local buffers can only be given a size -> " + t.s_value);
+            return;
+        }
+        l.size = numutils::getSizeValue(t.s_value);
+        if (data::state.error)
+            return;
+    }
+
+    if (checkForMore())
+    {
+        data::setError("Unexpected token after .local size -> " + data::token_list.getNext().s_value);
+        return;
+    }
+
+    data::data.locals.push_back(l);
+}
+
+void createVreg(void)
+{
+    if (!data::state.in_process)
+    {
+        data::setError(".vreg can only be declared inside a process");
+        return;
+    }
+
+    Token iden;
+    if (!getIdentifier(iden))
+        return;
+
+    if (checkForMore())
+    {
+        data::setError("a .vreg can not be given a value -> " + data::token_list.getNext().s_value);
+        return;
+    }
+
+    int location = VREG_STAND_IN_TOP - data::state.vreg_count++;
+    if (location < data::state.register_count)
+    {
+        data::setError("Too many registers to declare .vreg " + iden.s_value);
+        return;
+    }
+
+    VirtualRegister v;
+    v.name = iden.s_value;
+    v.line = data::state.line;
+    v.line_number = data::state.line_number;
+    v.process = data::data.process_count - 1;
+    v.stand_in = location;
+    data::data.vregs.push_back(v);
+
+    // The real register is shown in the listing once the allocator has placed it
+    data::data.log(data::state.line_number, -1, "", data::state.line);
+
+    int type = REGISTER;
+    int val = 0;
+    int size = 1;
+    std::string name = data::state.process_name + iden.s_value;
+
+    try
+    {
+        data::symbol_list.addSymbolToTable(data::state.error, type, val, size, location, name);
+    }
+    catch (const std::exception &ex)
+    {
+        data::setError("Register " + std::string(ex.what() + iden.s_value));
+    }
+}
+
+void createFlag(void)
+{
+    Token iden;
+    if (!getIdentifier(iden))
+        return;
+
+    if (checkForMore())
+    {
+        data::setError("unexpected token after flag name -> " + data::token_list.getNext().s_value);
+        return;
+    }
+
+    // Start a new register for the flags when the last one is full. A global flag can be 
+    // changed by any process and setb and clrb write back the whole register a few 
+    // cycles after reading it, so each global flag has a register of its own.
+    if (data::state.flag_bit > 15 || !data::state.in_process)
+    {
+        data::state.flag_register = data::state.register_count++;
+        data::state.flag_bit = 0;
+        data::data.addRegister("0000", declaringProcess()); // All flags start clear
+    }
+
+    int location = data::state.flag_register;
+    int bit = data::state.flag_bit++;
+    int type = FLAG;
+    int size = 1;
+
+    std::string name = data::state.process_name + iden.s_value;
+
+    std::string line = stutils::int_to_hex(((1 << bit) >> 8) & 0xff);
+    line += stutils::int_to_hex((1 << bit) & 0xff);
+    data::data.log(data::state.line_number, location, line, data::state.line);
+
+    try
+    {
+        data::symbol_list.addSymbolToTable(data::state.error, type, bit, size, location, name);
+    }
+    catch (const std::exception &ex)
+    {
+        data::setError("Flag " + std::string(ex.what() + iden.s_value));
+    }
+}
+
 } // namespace data_type
\ No newline at end of file
@@ -0,0 +1,1118 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#include "dataflow.hpp"
+#include "data.hpp"
+#include <deque>
+#include <set>
+
+namespace dataflow
+{
+
+/*
+  Where an indirect access through a pointer register can go
+  */
+class Pointer
+{
+public:
+    Registers regs;
+    bool port = false;
+    bool unknown = false;
+};
+
+/*
+  Registers read and written by each process
+  */
+static std::vector<Registers> reads;
+static std::vector<Registers> writes;
+
+/*
+  Where each register can point when it is used as a pointer
+  */
+static std::vector<Pointer> pointers;
+
+/*
+  Ids of the nodes whose address is loaded into a register or saved by a jal/jalr, and
+  of the nodes that are jumped to from another process
+  */
+static std::set<int> address_taken;
+static std::set<int> entered;
+
+/*
+  True if any process has a jump whose destination is not known. For each process, 
+  true if an address worked out by arithmetic can point into it, so that any of its 
+  nodes may be jumped to.
+  */
+static bool indirect_jumps = false;
+static std::vector<bool> arithmetic;
+
+/*
+  Registers that hold the address of a node, loaded by ldi or saved by a jal or jalr 
+  and only moved since, and registers that hold a value worked out from an address
+  */
+class Held
+{
+public:
+    Registers address;
+    Registers computed;
+
+    void merge(const Held &h)
+    {
+        address |= h.address;
+        computed |= h.computed;
+    }
+
+    bool operator==(const Held &h) const
+    {
+        return address == h.address && computed == h.computed;
+    }
+};
+
+bool isConstant(int v)
+{
+    return v >= 0 && v <= 0xffff;
+}
+
+static int meet(int a, int b)
+{
+    if (a == VALUE_UNDEF)
+        return b;
+    if (b == VALUE_UNDEF || a == b)
+        return a;
+    return VALUE_NAC;
+}
+
+static int initialValue(int reg)
+{
+    if (reg == 0)
+        return 0;
+    if (reg < (int)data::data.reg_list.size())
+        return std::stoul(data::data.reg_list[reg], 0, 16) & 0xffff;
+    return VALUE_NAC;
+}
+
+/*
+  Where an indirect access through ptr goes. If the register values are given and the 
+  pointer is a known constant the exact place is returned, otherwise everywhere the 
+  pointer may point is.
+  */
+static Pointer access(int ptr, const Values *v)
+{
+    Pointer p;
+    int a = v ? (*v)[ptr] : VALUE_NAC;
+    if (ptr == 0)
+        a = 0;
+    if (isConstant(a))
+    {
+        if (a < 0x100)
+            p.regs.set(a);
+        else if (a < 0x200)
+            p.port = true;
+        return p;
+    }
+    if (pointers.empty())
+        p.unknown = true;
+    else
+        p = pointers[ptr];
+    if (p.unknown)
+    {
+        p.regs.set();
+        p.port = true;
+    }
+    return p;
+}
+
+/*
+  jbs and jbc take a bit number in place of Rs1
+  */
+static bool isBitJump(int op)
+{
+    return program::isRegisterJump(op) && ((op & 0x07) == 0x05 || (op & 0x07) == 0x06);
+}
+
+Registers namedUses(program::Node &n)
+{
+    Registers r;
+    if (program::isALU(n.op))
+    {
+        int base = n.op & 0x3f;
+        if (!program::isBitOp(n.op))
+            r.set(n.rs1);
+        if (base != 0x05)
+            r.set(n.rs2);
+        if (n.op & OPCODE_RD_INDIRECT)
+            r.set(n.rd);
+    }
+    else if (program::isJZ(n.op) || program::isJALR(n.op))
+    {
+        r.set(n.rd);
+    }
+    else if (program::isRegisterJump(n.op))
+    {
+        r.set(n.rd);
+        if (!isBitJump(n.op))
+            r.set(n.rs1);
+        r.set(n.rs2);
+    }
+    else if (!program::isLDI(n.op) && !program::isJAL(n.op))
+    {
+        r.set();
+    }
+    return r;
+}
+
+Registers namedDefs(program::Node &n)
+{
+    Registers r;
+    if (program::isALU(n.op))
+    {
+        if (!(n.op & OPCODE_RD_INDIRECT))
+            r.set(n.rd);
+    }
+    else if (program::isLDI(n.op) || program::isJAL(n.op))
+    {
+        r.set(n.rd);
+    }
+    else if (program::isJALR(n.op))
+    {
+        r.set(n.rs1);
+    }
+    else if (!program::isRegisterJump(n.op) && !program::isJZ(n.op))
+    {
+        r.set();
+    }
+    r.reset(0);
+    return r;
+}
+
+static Registers nodeUses(program::Node &n, const Values *v)
+{
+    Registers r = namedUses(n);
+    bool reads_rs2 = (program::isALU(n.op) && (n.op & 0x3f) != 0x05) || (program::isRegisterJump(n.op) && !program::isJALR(n.op));
+    if (reads_rs2 && (n.op & OPCODE_RS2_INDIRECT))
+        r |= access(n.rs2, v).regs;
+    return r;
+}
+
+static Registers nodeDefs(program::Node &n, const Values *v, bool must)
+{
+    Registers r;
+    if (program::isALU(n.op))
+    {
+        if (!(n.op & OPCODE_RD_INDIRECT))
+            r.set(n.rd);
+        else if (!must)
+            r = access(n.rd, v).regs;
+        else if (v && isConstant((*v)[n.rd]) && (*v)[n.rd] < 0x100)
+            r.set((*v)[n.rd]);
+    }
+    else if (program::isLDI(n.op) || program::isJAL(n.op))
+    {
+        r.set(n.rd);
+    }
+    else if (program::isJALR(n.op))
+    {
+        r.set(n.rs1);
+    }
+    else if (!program::isRegisterJump(n.op) && !program::isJZ(n.op) && !must)
+    {
+        r.set();
+    }
+    r.reset(0);
+    return r;
+}
+
+/*
+  Returns true for an inc or dec of a register, using the one and minus one registers
+  */
+static bool isStep(program::Node &n)
+{
+    if ((n.op & 0x3f) != 0x00 || (n.op & (OPCODE_RD_INDIRECT | OPCODE_RS2_INDIRECT)) || n.rd == 0)
+        return false;
+    return (n.rd == n.rs1 && (n.rs2 == 1 || n.rs2 == 2)) || (n.rd == n.rs2 && (n.rs1 == 1 || n.rs1 == 2));
+}
+
+/*
+  The process scan() is limited to, -1 for all of them
+  */
+static int only = -1;
+
+static bool scanned(program::Code &c)
+{
+    return only < 0 || c.process == only;
+}
+
+/*
+  Work out where each register may point when used as a pointer. A register that is
+  only ever set by ldi can point at the values loaded and at its initial value. A 
+  register that is loaded with data RAM addresses and then only stepped with inc and 
+  dec is taken to stay in data RAM, as it does when walking through a buffer. 
+  Anything else is unknown.
+  */
+static void findPointers()
+{
+    pointers.assign(REGISTER_COUNT, Pointer());
+    std::vector<std::set<int>> values(REGISTER_COUNT);
+    std::vector<bool> stepped(REGISTER_COUNT, false);
+    std::vector<bool> other(REGISTER_COUNT, false);
+
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+    {
+        if (!scanned(*c))
+            continue;
+        for (auto n = c->nodes.begin(); n != c->nodes.end(); ++n)
+        {
+            if (program::isLDI(n->op) && !n->address)
+            {
+                values[n->rd].insert(n->imm());
+                continue;
+            }
+            if (program::isALU(n->op) && (n->op & OPCODE_RD_INDIRECT))
+                continue;
+            if (isStep(*n))
+            {
+                stepped[n->rd] = true;
+                continue;
+            }
+            Registers d = nodeDefs(*n, 0, false);
+            for (int r = 1; r < REGISTER_COUNT; r++)
+            {
+                if (d[r])
+                    other[r] = true;
+            }
+        }
+    }
+
+    // The step only moves by one if the one and minus one registers are left alone
+    bool steps = !other[1] && !other[2] && !stepped[1] && !stepped[2] && values[1].empty() && values[2].empty() &&
+                 initialValue(1) == 1 && initialValue(2) == 0xffff;
+
+    for (int r = 1; r < REGISTER_COUNT; r++)
+    {
+        if (stepped[r] && steps && !other[r] && !values[r].empty() && *values[r].begin() >= 0x200)
+        {
+            values[r].clear();
+            continue;
+        }
+        int v = initialValue(r);
+        if (isConstant(v))
+            values[r].insert(v);
+        if (!isConstant(v) || other[r] || stepped[r])
+            pointers[r].unknown = true;
+    }
+    values[0].insert(0);
+
+    // A register written through a pointer can hold anything. Repeat until settled as
+    // that may make other pointers unknown.
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int r = 1; r < REGISTER_COUNT; r++)
+        {
+            pointers[r].regs.reset();
+            pointers[r].port = false;
+            for (auto v = values[r].begin(); v != values[r].end(); ++v)
+            {
+                if (*v < 0x100)
+                    pointers[r].regs.set(*v);
+                else if (*v < 0x200)
+                    pointers[r].port = true;
+            }
+        }
+        for (auto c = program::code.begin(); c != program::code.end(); ++c)
+        {
+            if (!scanned(*c))
+                continue;
+            for (auto n = c->nodes.begin(); n != c->nodes.end(); ++n)
+            {
+                if (!program::isALU(n->op) || !(n->op & OPCODE_RD_INDIRECT))
+                    continue;
+                Registers d = access(n->rd, 0).regs;
+                for (int r = 1; r < REGISTER_COUNT; r++)
+                {
+                    if (d[r] && !pointers[r].unknown)
+                    {
+                        pointers[r].unknown = true;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+}
+
+/*
+  The position the register jump at position i goes to if it takes its address from 
+  an ldi of a label of the process directly in front of it and nothing else jumps to 
+  the register jump, otherwise -1. Nothing else jumping to it is only certain once 
+  no address that can point into the process is worked out by arithmetic.
+  */
+static int loadedTarget(program::Code &c, int i, Registers &foreign)
+{
+    if (i == 0)
+        return -1;
+    program::Node &n = c.nodes[i];
+    program::Node &l = c.nodes[i - 1];
+    if (!program::isLDI(l.op) || !l.address || l.target < 0 || l.rd != n.rd || n.rd == 0 || foreign[n.rd])
+        return -1;
+    if (address_taken.count(n.id) || entered.count(n.id))
+        return -1;
+    for (auto o = c.nodes.begin(); o != c.nodes.end(); ++o)
+    {
+        if (o->target >= 0 && program::resolve(o->target) == n.id)
+            return -1;
+    }
+    return c.indexOf(program::resolve(l.target));
+}
+
+static bool loadedJump(program::Code &c, int i, Registers &foreign)
+{
+    return !arithmetic[c.process] && loadedTarget(c, i, foreign) >= 0;
+}
+
+/*
+  Positions in the process that the node at position i may go to next, as far as they
+  can be told before the process is analysed. A jump whose destination is not known 
+  goes to the nodes whose address is taken.
+  */
+static std::vector<int> nextNodes(program::Code &c, int i, const std::vector<int> &taken, Registers &foreign)
+{
+    program::Node &n = c.nodes[i];
+    int count = c.nodes.size();
+    std::vector<int> next;
+    if (n.table && program::isJALR(n.op))
+    {
+        for (int p = i + 1; p < count && c.nodes[p].table && program::isJAL(c.nodes[p].op); p++)
+            next.push_back(p);
+        return next;
+    }
+    if (program::isJAL(n.op) || program::isJZ(n.op))
+    {
+        if (n.target >= 0)
+            next.push_back(c.indexOf(program::resolve(n.target)));
+        else
+            next = taken;
+    }
+    else if (program::isRegisterJump(n.op))
+    {
+        int t = program::isJALR(n.op) ? -1 : loadedTarget(c, i, foreign);
+        if (t >= 0)
+            next.push_back(t);
+        else
+            next = taken;
+    }
+    if (!program::isJAL(n.op) && !program::isJALR(n.op))
+        next.push_back(i + 1);
+    return next;
+}
+
+/*
+  Follow the registers that hold an address through a process from its start and 
+  from everywhere it may be entered. A register that is loaded with a number no 
+  longer holds one. Registers that other processes may leave holding an address, 
+  given in shared, are taken to hold one everywhere. Marks the process in arithmetic
+  if an address is used for anything other than a move, and returns the registers 
+  that the process itself may leave holding an address.
+  */
+static Held followAddresses(program::Code &c, const Held &shared)
+{
+    int count = c.nodes.size();
+    Registers foreign = foreignWrites(c.process);
+    std::vector<int> taken;
+    for (int i = 0; i < count; i++)
+    {
+        if (address_taken.count(c.nodes[i].id) || entered.count(c.nodes[i].id))
+            taken.push_back(i);
+    }
+
+    std::vector<Held> in(count);
+    std::vector<bool> seen(count, false);
+    std::deque<int> work;
+    Held left;
+    auto reach = [&](int p, const Held &h) {
+        if (p < 0 || p >= count)
+            return;
+        Held m = in[p];
+        m.merge(h);
+        if (!seen[p] || !(m == in[p]))
+        {
+            in[p] = m;
+            seen[p] = true;
+            work.push_back(p);
+        }
+    };
+    reach(0, shared);
+    for (auto t = taken.begin(); t != taken.end(); ++t)
+        reach(*t, shared);
+
+    while (!work.empty())
+    {
+        int i = work.front();
+        work.pop_front();
+        program::Node &n = c.nodes[i];
+        Held h = in[i];
+        h.merge(shared);
+
+        // What is written, and to which registers
+        bool address = false;
+        bool computed = false;
+        Registers to;
+        if (program::isALU(n.op))
+        {
+            int base = n.op & 0x3f;
+            bool move = !(n.op & (OPCODE_RD_INDIRECT | OPCODE_RS2_INDIRECT)) &&
+                        (base == 0x00 || base == 0x02 || base == 0x04) && (n.rs1 == 0 || n.rs2 == 0);
+            Registers any = h.address | h.computed;
+            if (move)
+            {
+                int from = n.rs1 == 0 ? n.rs2 : n.rs1;
+                address = h.address[from];
+                computed = h.computed[from];
+            }
+            // Indexing into a jump table is followed by the analysis itself
+            else if (!n.table && ((!program::isBitOp(n.op) && any[n.rs1]) ||
+                                  (base != 0x05 && !(n.op & OPCODE_RS2_INDIRECT) && any[n.rs2])))
+            {
+                arithmetic[c.process] = true;
+                computed = true;
+            }
+            if (!(n.op & OPCODE_RD_INDIRECT))
+                to.set(n.rd);
+            else if (address || computed)
+                to = access(n.rd, 0).regs;
+        }
+        else if (program::isLDI(n.op) || (program::isJAL(n.op) && n.rd != 0))
+        {
+            address = program::isJAL(n.op) || n.address;
+            to.set(n.rd);
+        }
+        else if (program::isJALR(n.op) && n.rs1 != 0)
+        {
+            address = true;
+            to.set(n.rs1);
+        }
+        to.reset(0);
+
+        // A write through a pointer may miss, so it takes nothing away
+        if (!program::isALU(n.op) || !(n.op & OPCODE_RD_INDIRECT))
+        {
+            h.address &= ~to;
+            h.computed &= ~to;
+        }
+        if (address)
+        {
+            h.address |= to;
+            left.address |= to;
+        }
+        if (computed)
+        {
+            h.computed |= to;
+            left.computed |= to;
+        }
+
+        std::vector<int> next = nextNodes(c, i, taken, foreign);
+        for (auto t = next.begin(); t != next.end(); ++t)
+            reach(*t, h);
+    }
+    return left;
+}
+
+void scan(int process)
+{
+    only = process;
+    reads.clear();
+    writes.clear();
+    address_taken.clear();
+    entered.clear();
+    indirect_jumps = false;
+    arithmetic.clear();
+    pointers.clear();
+
+    findPointers();
+
+    std::map<int, int> owner;
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+    {
+        for (auto n = c->nodes.begin(); n != c->nodes.end(); ++n)
+            owner[n->id] = c->process;
+    }
+
+    // The processes whose nodes each process loads the address of
+    std::vector<std::set<int>> loads(program::code.size());
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+    {
+        Registers rd, wr;
+        if (!scanned(*c))
+        {
+            // Kept so that reads and writes stay in process order
+            reads.push_back(rd);
+            writes.push_back(wr);
+            continue;
+        }
+        for (std::size_t i = 0; i < c->nodes.size(); i++)
+        {
+            program::Node &n = c->nodes[i];
+            rd |= nodeUses(n, 0);
+            wr |= nodeDefs(n, 0, false);
+
+            int next = (i + 1) < c->nodes.size() ? c->nodes[i + 1].id : c->end_id;
+            if (program::isLDI(n.op) && n.address)
+            {
+                if (n.target >= 0)
+                {
+                    address_taken.insert(program::resolve(n.target));
+                    auto o = owner.find(program::resolve(n.target));
+                    loads[c->process].insert(o != owner.end() ? o->second : c->process);
+                }
+            }
+            else if (program::isJAL(n.op) && n.rd != 0)
+                address_taken.insert(next);
+            else if (program::isJALR(n.op) && n.rs1 != 0)
+                address_taken.insert(next);
+            if ((program::isJAL(n.op) || program::isJZ(n.op)) && n.target >= 0)
+            {
+                auto o = owner.find(program::resolve(n.target));
+                if (o != owner.end() && o->second != c->process)
+                    entered.insert(o->first);
+            }
+        }
+        reads.push_back(rd);
+        writes.push_back(wr);
+    }
+
+    // Follow the addresses through each process until what the processes leave in
+    // the registers they share settles
+    arithmetic.assign(program::code.size(), false);
+    std::vector<Held> left(program::code.size());
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (auto c = program::code.begin(); c != program::code.end(); ++c)
+        {
+            if (!scanned(*c))
+                continue;
+            Held shared;
+            for (std::size_t p = 0; p < left.size(); p++)
+            {
+                if ((int)p != c->process)
+                    shared.merge(left[p]);
+            }
+            Held l = followAddresses(*c, shared);
+            if (!(l == left[c->process]))
+            {
+                left[c->process] = l;
+                changed = true;
+            }
+        }
+    }
+
+    // A worked out address can point anywhere in the processes whose addresses the
+    // process loads, or is handed through a register it shares
+    std::vector<std::set<int>> reach = loads;
+    for (std::size_t p = 0; p < reach.size(); p++)
+        reach[p].insert(p);
+    changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (std::size_t p = 0; p < reach.size(); p++)
+        {
+            for (std::size_t q = 0; q < reach.size(); q++)
+            {
+                if (p == q || p >= reads.size() || !((left[q].address | left[q].computed) & reads[p]).any())
+                    continue;
+                for (auto r = reach[q].begin(); r != reach[q].end(); ++r)
+                    changed |= reach[p].insert(*r).second;
+            }
+        }
+    }
+    std::vector<bool> computes = arithmetic;
+    for (std::size_t p = 0; p < computes.size(); p++)
+    {
+        if (!computes[p])
+            continue;
+        for (auto r = reach[p].begin(); r != reach[p].end(); ++r)
+        {
+            if (*r >= 0 && *r < (int)arithmetic.size())
+                arithmetic[*r] = true;
+        }
+    }
+
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+    {
+        if (!scanned(*c))
+            continue;
+        Registers foreign = foreignWrites(c->process);
+        for (std::size_t i = 0; i < c->nodes.size(); i++)
+        {
+            int op = c->nodes[i].op;
+            if (c->nodes[i].table)
+                continue;
+            if (program::isJALR(op) || (program::isRegisterJump(op) && !loadedJump(*c, i, foreign)))
+                indirect_jumps = true;
+        }
+    }
+}
+
+Registers foreignReads(int process)
+{
+    Registers r;
+    for (std::size_t p = 0; p < reads.size(); p++)
+    {
+        if ((int)p != process)
+            r |= reads[p];
+    }
+    return r;
+}
+
+Registers foreignWrites(int process)
+{
+    Registers r;
+    for (std::size_t p = 0; p < writes.size(); p++)
+    {
+        if ((int)p != process)
+            r |= writes[p];
+    }
+    return r;
+}
+
+Analysis::Analysis(program::Code &c) : code(c)
+{
+    foreign_read = foreignReads(c.process);
+    foreign_write = foreignWrites(c.process);
+
+    Registers written;
+    for (auto w = writes.begin(); w != writes.end(); ++w)
+        written |= *w;
+
+    // Registers that nothing writes keep their initial value, registers that other
+    // processes write can hold anything. Both are fixed for the whole analysis.
+    initial.assign(REGISTER_COUNT, VALUE_NAC);
+    fixed.assign(REGISTER_COUNT, false);
+    for (int r = 0; r < REGISTER_COUNT; r++)
+    {
+        initial[r] = initialValue(r);
+        if (r == 0 || !written[r] || foreign_write[r])
+            fixed[r] = true;
+        if (r != 0 && written[r] && foreign_write[r])
+            initial[r] = VALUE_NAC;
+    }
+
+    int count = c.nodes.size();
+    for (int i = 0; i < count; i++)
+        positions[c.nodes[i].id] = i;
+    positions[c.end_id] = count;
+
+    resolved.assign(count, -1);
+    tables.assign(count, std::vector<int>());
+    unknown_entry.assign(count, false);
+    for (int i = 0; i < count; i++)
+    {
+        // A switch jalr goes to one of the entries of the table that follows it
+        if (c.nodes[i].table && program::isJALR(c.nodes[i].op))
+        {
+            for (int p = i + 1; p < count && c.nodes[p].table && program::isJAL(c.nodes[p].op); p++)
+                tables[i].push_back(p);
+        }
+        program::Node &n = c.nodes[i];
+        if (program::isRegisterJump(n.op) && loadedJump(c, i, foreign_write))
+            resolved[i] = position(program::resolve(c.nodes[i - 1].target));
+        if (entered.count(n.id) || (indirect_jumps && (arithmetic[c.process] || address_taken.count(n.id))))
+            unknown_entry[i] = true;
+    }
+}
+
+int Analysis::position(int id)
+{
+    auto p = positions.find(id);
+    return p == positions.end() ? -1 : p->second;
+}
+
+int Analysis::jumpTarget(int i)
+{
+    program::Node &n = code.nodes[i];
+    if (program::isRegisterJump(n.op))
+        return resolved[i];
+    if ((program::isJAL(n.op) || program::isJZ(n.op)) && n.target >= 0)
+        return position(program::resolve(n.target));
+    return -1;
+}
+
+void Analysis::buildGraph()
+{
+    int count = code.nodes.size();
+    succ.assign(count, std::vector<int>());
+    unknown_exit.assign(count, false);
+    for (int i = 0; i < count; i++)
+    {
+        int op = code.nodes[i].op;
+        if (!tables[i].empty())
+        {
+            succ[i] = tables[i];
+            continue;
+        }
+        if (program::isJAL(op) || program::isJZ(op) || program::isRegisterJump(op))
+        {
+            int t = jumpTarget(i);
+            if (t >= 0)
+                succ[i].push_back(t);
+            else
+                unknown_exit[i] = true;
+            if (program::isJAL(op) || program::isJALR(op))
+                continue;
+        }
+        succ[i].push_back(i + 1);
+    }
+}
+
+void Analysis::set(Values &v, int reg, int value)
+{
+    if (!fixed[reg])
+        v[reg] = value;
+}
+
+int Analysis::evaluate(int i, Values &v)
+{
+    program::Node &n = code.nodes[i];
+    int base = n.op & 0x3f;
+    int a = v[n.rs1];
+    int b = v[n.rs2];
+    if (n.op & OPCODE_RS2_INDIRECT)
+    {
+        if (isConstant(b) && b < 0x100)
+            b = v[b];
+        else if (b != VALUE_UNDEF)
+            b = VALUE_NAC;
+    }
+
+    if (base == 0x05)
+    {
+        b = 0;
+    }
+    else if (program::isBitOp(n.op))
+    {
+        a = 0;
+    }
+    else if (base != 0x03)
+    {
+        // Moving a value, the value may be an address
+        if (a == 0)
+            return b;
+        if (b == 0)
+            return a;
+    }
+    else if (a == 0 || b == 0)
+    {
+        return 0;
+    }
+
+    if (a == VALUE_UNDEF || b == VALUE_UNDEF)
+        return VALUE_UNDEF;
+    if (!isConstant(a) || !isConstant(b))
+        return VALUE_NAC;
+
+    int bit = 1 << (n.rs1 & 0x0f);
+    switch (base)
+    {
+    case 0x00:
+        return (a + b) & 0xffff;
+    case 0x02:
+        return a | b;
+    case 0x03:
+        return a & b;
+    case 0x04:
+        return a ^ b;
+    case 0x05:
+        return a >> 1;
+    case 0x06:
+        return b & ~bit & 0xffff;
+    case 0x07:
+        return b | bit;
+    }
+    return VALUE_NAC;
+}
+
+/*
+  Returns 1 if the conditional jump n is always taken with the register values v, 
+  0 if it never is and -1 if that is not known.
+  */
+static int condition(program::Node &n, Values &v)
+{
+    if (program::isJZ(n.op))
+    {
+        if (!isConstant(v[n.rd]))
+            return -1;
+        return (v[n.rd] == 0) == (n.op == 0x94);
+    }
+    int a = v[n.rs1];
+    int b = v[n.rs2];
+    if (n.op & OPCODE_RS2_INDIRECT)
+        b = (isConstant(b) && b < 0x100) ? v[b] : VALUE_NAC;
+    if (isBitJump(n.op))
+    {
+        if (!isConstant(b))
+            return -1;
+        int set = (b >> (n.rs1 & 0x0f)) & 1;
+        return (n.op & 0x07) == 0x05 ? set : !set;
+    }
+    if (!isConstant(a) || !isConstant(b))
+        return -1;
+    switch (n.op & 0x07)
+    {
+    case 0x01:
+        return a == b;
+    case 0x02:
+        return a != b;
+    case 0x03:
+        return a < b;
+    case 0x04:
+        return a >= b;
+    }
+    return -1;
+}
+
+int Analysis::branch(int i)
+{
+    program::Node &n = code.nodes[i];
+    if (!program::isConditionalJump(n.op))
+        return -1;
+    return condition(n, in[i]);
+}
+
+void Analysis::transfer(int i, Values &v)
+{
+    program::Node &n = code.nodes[i];
+    int next = (i + 1) < (int)code.nodes.size() ? code.nodes[i + 1].id : code.end_id;
+
+    if (program::isLDI(n.op))
+    {
+        if (!n.address)
+            set(v, n.rd, n.imm());
+        else
+            set(v, n.rd, n.target >= 0 ? VALUE_ADDRESS + program::resolve(n.target) : VALUE_NAC);
+    }
+    else if (program::isJAL(n.op))
+    {
+        set(v, n.rd, VALUE_ADDRESS + next);
+    }
+    else if (program::isJALR(n.op))
+    {
+        set(v, n.rs1, VALUE_ADDRESS + next);
+    }
+    else if (program::isALU(n.op))
+    {
+        int r = evaluate(i, v);
+        if (!(n.op & OPCODE_RD_INDIRECT))
+        {
+            set(v, n.rd, r);
+        }
+        else if (isConstant(v[n.rd]))
+        {
+            if (v[n.rd] < 0x100)
+                set(v, v[n.rd], r);
+        }
+        else
+        {
+            Registers d = access(n.rd, 0).regs;
+            for (int reg = 0; reg < REGISTER_COUNT; reg++)
+            {
+                if (d[reg])
+                    set(v, reg, VALUE_NAC);
+            }
+        }
+    }
+    else if (!program::isRegisterJump(n.op) && !program::isJZ(n.op))
+    {
+        for (int reg = 0; reg < REGISTER_COUNT; reg++)
+            set(v, reg, VALUE_NAC);
+    }
+}
+
+Registers Analysis::uses(int i, Values &v)
+{
+    return nodeUses(code.nodes[i], &v);
+}
+
+Registers Analysis::defs(int i, Values &v)
+{
+    return nodeDefs(code.nodes[i], &v, true);
+}
+
+Registers Analysis::mayDefs(int i, Values &v)
+{
+    return nodeDefs(code.nodes[i], &v, false);
+}
+
+bool Analysis::sideEffectFree(int i, Values &v)
+{
+    program::Node &n = code.nodes[i];
+    if (program::isLDI(n.op))
+        return n.rd != 0;
+    if (!program::isALU(n.op))
+        return false;
+    if (n.op & OPCODE_RD_INDIRECT)
+    {
+        if (!isConstant(v[n.rd]) || v[n.rd] >= 0x100 || v[n.rd] == 0)
+            return false;
+    }
+    else if (n.rd == 0)
+    {
+        // Nothing is written, this is a nop kept for its timing
+        return false;
+    }
+    if ((n.op & OPCODE_RS2_INDIRECT) && (n.op & 0x3f) != 0x05)
+    {
+        Pointer p = access(n.rs2, &v);
+        if (p.port)
+            return false;
+    }
+    return true;
+}
+
+void Analysis::constants()
+{
+    int count = code.nodes.size();
+    in.assign(count, Values(REGISTER_COUNT, VALUE_UNDEF));
+    reachable.assign(count, false);
+
+    std::deque<int> work;
+    std::vector<bool> queued(count, false);
+
+    auto merge = [&](int j, Values &v) {
+        if (j < 0 || j >= count)
+            return;
+        bool changed = !reachable[j];
+        reachable[j] = true;
+        for (int r = 0; r < REGISTER_COUNT; r++)
+        {
+            int m = meet(in[j][r], v[r]);
+            if (m != in[j][r])
+            {
+                in[j][r] = m;
+                changed = true;
+            }
+        }
+        if (changed && !queued[j])
+        {
+            queued[j] = true;
+            work.push_back(j);
+        }
+    };
+
+    Values unknown(REGISTER_COUNT, VALUE_NAC);
+    for (int r = 0; r < REGISTER_COUNT; r++)
+    {
+        if (fixed[r])
+            unknown[r] = initial[r];
+    }
+    if (count)
+        merge(0, initial);
+    for (int i = 0; i < count; i++)
+    {
+        if (unknown_entry[i])
+            merge(i, unknown);
+    }
+
+    while (!work.empty())
+    {
+        int i = work.front();
+        work.pop_front();
+        queued[i] = false;
+
+        Values v = in[i];
+        transfer(i, v);
+        int taken = branch(i);
+        int t = jumpTarget(i);
+        for (auto s = succ[i].begin(); s != succ[i].end(); ++s)
+        {
+            if (taken == 1 && *s != t)
+                continue;
+            if (taken == 0 && *s != i + 1)
+                continue;
+            merge(*s, v);
+        }
+    }
+}
+
+void Analysis::liveness()
+{
+    int count = code.nodes.size();
+    Registers all;
+    all.set();
+
+    std::vector<Registers> use(count), def(count);
+    live_in.assign(count, Registers());
+    for (int i = 0; i < count; i++)
+    {
+        use[i] = uses(i, in[i]);
+        def[i] = defs(i, in[i]);
+    }
+    live_out.assign(count, Registers());
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = count - 1; i >= 0; i--)
+        {
+            Registers out = foreign_read;
+            if (unknown_exit[i])
+                out = all;
+            for (auto s = succ[i].begin(); s != succ[i].end(); ++s)
+                out |= *s < count ? live_in[*s] : all;
+            Registers l = use[i] | (out & ~def[i]);
+            if (l != live_in[i] || out != live_out[i])
+            {
+                live_in[i] = l;
+                live_out[i] = out;
+                changed = true;
+            }
+        }
+    }
+}
+
+void Analysis::run()
+{
+    int count = code.nodes.size();
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        buildGraph();
+        constants();
+        // A register jump whose register holds a known label goes there
+        for (int i = 0; i < count; i++)
+        {
+            program::Node &n = code.nodes[i];
+            if (!reachable[i] || !program::isRegisterJump(n.op) || resolved[i] >= 0)
+                continue;
+            int v = in[i][n.rd];
+            if (v < VALUE_ADDRESS)
+                continue;
+            int p = position(v - VALUE_ADDRESS);
+            if (p >= 0 && p < count)
+            {
+                resolved[i] = p;
+                changed = true;
+            }
+        }
+    }
+    liveness();
+}
+
+} // namespace dataflow
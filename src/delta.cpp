@@ -0,0 +1,195 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#include "delta.hpp"
+#include "bundle.hpp"
+#include "data.hpp"
+#include "image.hpp"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <vector>
+
+namespace delta
+{
+
+/*
+  The images a delta is made of, in the order they are written
+  */
+class Image
+{
+public:
+    int type;
+    std::string label;
+    int width;
+};
+
+static const std::vector<Image> images = {
+    {bundle::SECTION_INST, image::IMAGE_INST, 32},
+    {bundle::SECTION_DATA, image::IMAGE_DATA, 8},
+    {bundle::SECTION_PC, image::IMAGE_PC, 16},
+    {bundle::SECTION_REG, image::IMAGE_REG, 16},
+    {bundle::SECTION_SEQ, image::IMAGE_SEQ, 8}};
+
+/*
+  The file name an image is written to by the assembler
+  */
+static std::string fileOf(int type)
+{
+    switch (type)
+    {
+    case bundle::SECTION_INST:
+        return data::options.inst_file;
+    case bundle::SECTION_DATA:
+        return data::options.data_file;
+    case bundle::SECTION_PC:
+        return data::options.pc_file;
+    case bundle::SECTION_REG:
+        return data::options.reg_file;
+    default:
+        return data::options.seq_file;
+    }
+}
+
+/*
+  Read the images of a build from a bundle or a directory, as raw little endian bytes
+  by section type
+  */
+static bool load(std::string name, std::vector<std::vector<unsigned char>> &build)
+{
+    build.assign(bundle::SECTION_SEQ + 1, std::vector<unsigned char>());
+    struct stat st;
+    if (stat(name.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        for (auto i = images.begin(); i != images.end(); ++i)
+        {
+            std::string file = name + "/" + fileOf(i->type);
+            std::ifstream f(file);
+            if (!f.is_open())
+            {
+                std::cout << "Failed to open file - " << file << std::endl;
+                return false;
+            }
+            std::vector<std::string> words;
+            std::string line;
+            while (std::getline(f, line))
+            {
+                stutils::trim(line);
+                if (!line.empty())
+                    words.push_back(line);
+            }
+            build[i->type] = image::toBinary(words, i->width);
+        }
+        return true;
+    }
+
+    std::vector<bundle::Section> sections;
+    if (!bundle::read(name, sections))
+        return false;
+    for (auto s = sections.begin(); s != sections.end(); ++s)
+    {
+        if (s->type >= bundle::SECTION_INST && s->type <= bundle::SECTION_SEQ)
+            build[s->type] = s->contents;
+    }
+    return true;
+}
+
+static void put(std::vector<unsigned char> &b, unsigned long long value, int size)
+{
+    for (int i = 0; i < size; i++)
+        b.push_back((value >> (8 * i)) & 0xff);
+}
+
+static std::string hex(unsigned long long value, int digits)
+{
+    std::stringstream s;
+    s << std::hex << std::setw(digits) << std::setfill('0') << value;
+    return s.str();
+}
+
+bool diff(std::string base, std::string next, bool quiet)
+{
+    std::vector<std::vector<unsigned char>> from, to;
+    if (!load(base, from) || !load(next, to))
+        return false;
+
+    std::ofstream text("delta.txt");
+    std::vector<unsigned char> binary(MAGIC.begin(), MAGIC.end());
+    put(binary, VERSION, 4);
+    put(binary, images.size(), 4);
+    text << "; delta from " << base << " to " << next << "\n";
+
+    for (auto i = images.begin(); i != images.end(); ++i)
+    {
+        int size = i->width / 8;
+        std::vector<std::string> old_words = image::fromBinary(from[i->type], i->width);
+        std::vector<std::string> new_words = image::fromBinary(to[i->type], i->width);
+        unsigned long long old_hash = bundle::hash(from[i->type], 0, from[i->type].size());
+        unsigned long long new_hash = bundle::hash(to[i->type], 0, to[i->type].size());
+
+        // Runs of changed words, joined when the words between them cost less than a range
+        std::vector<std::pair<int, int>> ranges;
+        for (int w = 0; w < (int)new_words.size(); w++)
+        {
+            if (w < (int)old_words.size() && old_words[w] == new_words[w])
+                continue;
+            if (!ranges.empty() && (w - ranges.back().second) * size <= RANGE_HEADER_SIZE)
+                ranges.back().second = w + 1;
+            else
+                ranges.push_back(std::make_pair(w, w + 1));
+        }
+
+        put(binary, i->type, 4);
+        put(binary, i->width, 4);
+        put(binary, old_words.size(), 4);
+        put(binary, old_hash, 8);
+        put(binary, new_words.size(), 4);
+        put(binary, new_hash, 8);
+        put(binary, ranges.size(), 4);
+        text << i->label << " base " << old_words.size() << " " << hex(old_hash, 16)
+             << " new " << new_words.size() << " " << hex(new_hash, 16) << "\n";
+
+        int changed = 0;
+        for (auto r = ranges.begin(); r != ranges.end(); ++r)
+        {
+            put(binary, r->first, 4);
+            put(binary, r->second - r->first, 4);
+            text << i->label << " " << hex(r->first, 4) << " " << (r->second - r->first);
+            for (int w = r->first; w < r->second; w++)
+            {
+                binary.insert(binary.end(), to[i->type].begin() + w * size, to[i->type].begin() + (w + 1) * size);
+                text << " " << new_words[w];
+            }
+            text << "\n";
+            changed += r->second - r->first;
+        }
+        if (!quiet)
+            std::cout << i->label << " " << ranges.size() << " ranges, " << changed << " of " << new_words.size() << " words" << std::endl;
+    }
+    text.close();
+
+    std::ofstream f("delta.avd", std::ios::binary);
+    f.write((const char *)binary.data(), binary.size());
+    f.close();
+    if (!quiet)
+        std::cout << "delta " << binary.size() << " bytes" << std::endl;
+    return true;
+}
+
+} // namespace delta
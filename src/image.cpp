@@ -0,0 +1,204 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#include "image.hpp"
+#include "data.hpp"
+#include "string_utils.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace image
+{
+
+static const std::vector<std::string> format_names = {"hex", "bin", "ihex", "coe", "mem", "mif"};
+static const std::vector<std::string> extensions = {"", ".bin", ".hex", ".coe", ".mem", ".mif"};
+
+/*
+  The number of bytes of data in each Intel HEX record
+  */
+static const int IHEX_RECORD_SIZE = 16;
+
+/*
+  The number of words on each line of a .mem file
+  */
+static const int MEM_LINE_SIZE = 16;
+
+int parseFormat(const std::string &name)
+{
+    for (std::size_t f = 0; f < format_names.size(); f++)
+    {
+        if (format_names[f] == name)
+            return f;
+    }
+    return -1;
+}
+
+int formatOf(const std::string &image)
+{
+    auto f = data::options.image_formats.find(image);
+    return parseFormat(f == data::options.image_formats.end() ? data::options.image_format : f->second);
+}
+
+/*
+  A number as hex digits
+  */
+static std::string hex(unsigned long value, int digits)
+{
+    std::stringstream s;
+    s << std::uppercase << std::hex << std::setw(digits) << std::setfill('0') << value;
+    return s.str();
+}
+
+/*
+  The bytes of a word, least significant first
+  */
+static std::vector<unsigned char> bytes(const std::string &word, int width)
+{
+    unsigned long value = std::stoul(word, 0, 16);
+    std::vector<unsigned char> b;
+    for (int i = 0; i < width / 8; i++)
+        b.push_back((value >> (8 * i)) & 0xff);
+    return b;
+}
+
+std::vector<unsigned char> toBinary(const std::vector<std::string> &words, int width)
+{
+    std::vector<unsigned char> binary;
+    for (auto w = words.begin(); w != words.end(); ++w)
+    {
+        std::vector<unsigned char> b = bytes(*w, width);
+        binary.insert(binary.end(), b.begin(), b.end());
+    }
+    return binary;
+}
+
+std::vector<std::string> fromBinary(const std::vector<unsigned char> &binary, int width)
+{
+    std::vector<std::string> words;
+    int size = width / 8;
+    for (std::size_t i = 0; i + size <= binary.size(); i += size)
+    {
+        std::string word;
+        for (int b = size - 1; b >= 0; b--)
+            word += stutils::int_to_hex(binary[i + b]);
+        words.push_back(word);
+    }
+    return words;
+}
+
+/*
+  Write an Intel HEX record with its byte count and checksum
+  */
+static void record(std::ofstream &f, int address, int type, const std::vector<unsigned char> &data)
+{
+    int sum = data.size() + ((address >> 8) & 0xff) + (address & 0xff) + type;
+    f << ":" << hex(data.size(), 2) << hex(address & 0xffff, 4) << hex(type, 2);
+    for (auto d = data.begin(); d != data.end(); ++d)
+    {
+        f << hex(*d, 2);
+        sum += *d;
+    }
+    f << hex((-sum) & 0xff, 2) << "\n";
+}
+
+static void writeIntelHex(std::ofstream &f, const std::vector<std::string> &words, int width)
+{
+    std::vector<unsigned char> image = toBinary(words, width);
+    int segment = 0;
+    for (std::size_t a = 0; a < image.size(); a += IHEX_RECORD_SIZE)
+    {
+        if ((int)(a >> 16) != segment)
+        {
+            segment = a >> 16;
+            record(f, 0, 4, {(unsigned char)(segment >> 8), (unsigned char)segment});
+        }
+        std::size_t end = std::min(image.size(), a + IHEX_RECORD_SIZE);
+        record(f, a, 0, std::vector<unsigned char>(image.begin() + a, image.begin() + end));
+    }
+    record(f, 0, 1, {});
+}
+
+void write(std::string name, const std::vector<std::string> &words, int width, int format)
+{
+    if (format < 0)
+        format = FORMAT_HEX;
+    name += extensions[format];
+    int digits = width / 4;
+    int address_digits = 1;
+    while ((std::size_t)1 << (4 * address_digits) < words.size())
+        address_digits++;
+
+    std::ofstream f;
+    if (format == FORMAT_BIN)
+        f.open(name, std::ios::binary);
+    else
+        f.open(name);
+
+    switch (format)
+    {
+    case FORMAT_BIN:
+    {
+        std::vector<unsigned char> b = toBinary(words, width);
+        f.write((const char *)b.data(), b.size());
+        break;
+    }
+    case FORMAT_IHEX:
+        writeIntelHex(f, words, width);
+        break;
+    case FORMAT_COE:
+        f << "; " << words.size() << " words of " << width << " bits\n";
+        f << "memory_initialization_radix=16;\n";
+        f << "memory_initialization_vector=\n";
+        for (std::size_t i = 0; i < words.size(); i++)
+            f << hex(std::stoul(words[i], 0, 16), digits) << (i + 1 < words.size() ? ",\n" : ";\n");
+        if (words.empty())
+            f << "0;\n";
+        break;
+    case FORMAT_MEM:
+        for (std::size_t i = 0; i < words.size(); i++)
+        {
+            if (i % MEM_LINE_SIZE == 0)
+                f << (i ? "\n" : "") << "@" << hex(i, 8);
+            f << " " << hex(std::stoul(words[i], 0, 16), digits);
+        }
+        if (!words.empty())
+            f << "\n";
+        break;
+    case FORMAT_MIF:
+        f << "WIDTH=" << width << ";\n";
+        f << "DEPTH=" << (words.empty() ? 1 : words.size()) << ";\n";
+        f << "ADDRESS_RADIX=HEX;\n";
+        f << "DATA_RADIX=HEX;\n";
+        f << "CONTENT BEGIN\n";
+        for (std::size_t i = 0; i < words.size(); i++)
+            f << "\t" << hex(i, address_digits) << " : " << hex(std::stoul(words[i], 0, 16), digits) << ";\n";
+        if (words.empty())
+            f << "\t0 : " << hex(0, digits) << ";\n";
+        f << "END;\n";
+        break;
+    default:
+        for (auto w = words.begin(); w != words.end(); ++w)
+            f << *w + "\n";
+        break;
+    }
+    f.flush();
+    f.close();
+}
+
+} // namespace image
@@ -0,0 +1,63 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#ifndef ALLOCATOR_HPP
+#define ALLOCATOR_HPP
+
+#include <string>
+#include <vector>
+
+namespace allocator
+{
+
+/*
+Pressure
+
+How the .vreg registers of one process were placed. The pressure is the most .vreg 
+registers that hold a value that is still needed at any one point of the process.
+*/
+class Pressure
+{
+public:
+  std::string process;
+  int vregs = 0;
+  int registers = 0;
+  int pressure = 0;
+};
+
+extern std::vector<Pressure> report;
+
+/*
+Place the .vreg registers of every process in real registers. The registers of each 
+process are worked out from the liveness of its .vreg registers, two of them share a 
+register when neither is needed while the other holds a value. A .vreg only ever
+shares with the .vreg registers of its own process as the processes run at the same 
+time. Only the registers named by instructions are followed, a .vreg must never be 
+reached through a pointer.
+
+This must be called straight after program::load() and before any other pass adds
+registers.
+*/
+void allocate();
+
+/*
+Print the registers used by each process that has .vreg registers to the screen
+*/
+void printReport();
+
+} // namespace allocator
+
+#endif
@@ -19,11 +19,183 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <utility>
 #include <fstream>
 #include <sstream>
 #include "string_utils.hpp"
 #include "token.hpp"
 
+/*
+The kinds of entry that can appear in the assembly listing
+*/
+enum listing_kinds
+{
+  LISTING_TEXT,
+  LISTING_INSTRUCTION,
+  LISTING_ADDRESS,
+  LISTING_PROCESS
+};
+
+/*
+ListingEntry
+
+A single line of the assembly listing. Entries are stored unformatted so that the
+locations of instructions can still be changed after assembly, the listing is only
+formatted when it is written to disk.
+*/
+class ListingEntry
+{
+public:
+  /*
+  The source line this entry belongs to, 0 if the entry has not been used
+  */
+  int ln = 0;
+
+  /*
+  The memory location shown for this entry, -1 for none
+  */
+  int location = -1;
+
+  /*
+  What this entry shows. For LISTING_INSTRUCTION the location is the index of the 
+  instruction in ins_list, for LISTING_ADDRESS (labels) it is the index of the 
+  instruction that the line points at. For LISTING_PROCESS it is the address the 
+  process starts at, which is in front of its first instruction when code is hoisted
+  out of a loop at the start of the process.
+  */
+  int kind = LISTING_TEXT;
+
+  std::string data;
+  std::string line;
+
+  /*
+  The clock cycles shown for an instruction when the program is timed with -W
+  */
+  std::string cycles;
+
+  /*
+  The share of the PC samples that fell on an instruction when a trace is given with -P
+  */
+  std::string samples;
+};
+
+/*
+ListingLine
+
+All of the listing entries produced by a single source line. Macros insert their
+expanded instructions in front of the line, everything else sets the main entry.
+*/
+class ListingLine
+{
+public:
+  std::vector<ListingEntry> inserted;
+  ListingEntry main;
+};
+
+/*
+InstructionInfo
+
+Information about an instruction in ins_list that can not be recovered from its 
+opcode. This is kept in step with ins_list so that later passes can move 
+instructions around and still fix up every address that refers to them.
+*/
+class InstructionInfo
+{
+public:
+  /*
+  The source line that produced the instruction
+  */
+  int line_number = 0;
+
+  /*
+  The index in pc_list of the process that the instruction belongs to
+  */
+  int process = -1;
+
+  /*
+  True when the 16 bit immediate of an ldi is the address of an instruction (a label)
+  jal, jz and jnz immediates are always addresses so they do not need this set.
+  */
+  bool address = false;
+
+  /*
+  True for the entries of a jump table made by switch and for the add and jalr that 
+  index into it. These must stay together and in order.
+  */
+  bool table = false;
+};
+
+/*
+Hint
+
+A hint given to the assembler with a directive such as .unroll. A hint applies to the 
+code that follows it in its process.
+*/
+class Hint
+{
+public:
+  /*
+  The directive that gave the hint
+  */
+  std::string name;
+
+  int line_number = 0;
+  int process = -1;
+
+  /*
+  The value given with the hint, 0 if there was none
+  */
+  int value = 0;
+};
+
+/*
+VirtualRegister
+
+A register declared with .vreg. While the program is assembled it is given a stand in 
+register number, counting down from the top of the register file in each process. The 
+register allocator later places it in a real register that it may share with other 
+.vreg registers of the same process.
+*/
+class VirtualRegister
+{
+public:
+  std::string name;
+  std::string line;
+  int line_number = 0;
+  int process = -1;
+  int stand_in = 0;
+};
+
+/*
+LocalData
+
+A scratch buffer declared with .local that belongs to a subroutine. Its address is
+chosen once the whole program has been read, buffers of subroutines that can never
+be running at the same time share the same data RAM.
+*/
+class LocalData
+{
+public:
+  std::string name;
+  std::string routine;
+  std::string process;
+  std::string line;
+  int line_number = 0;
+  int size = 1;
+};
+
+/*
+The stand in register number given to the first .vreg of each process
+*/
+const int VREG_STAND_IN_TOP = 0xff;
+
+/*
+The number of words in each bank of a ROM made by createRomFile, each bank is a case
+statement of its own
+*/
+const int ROM_BANK_SIZE = 256;
+
 class AsmData
 {
 private:
@@ -31,16 +203,15 @@ private:
   int sequenceCount = 0;
 
   /*
-    This is the listing output for the generated assembly code
+    This is the listing output for the generated assembly code, one entry for 
+    every line in the source file
     */
-  std::vector<std::string> asm_listing;
+  std::vector<ListingLine> asm_listing;
 
   /*
-  An offset used when inserting lines into the listing output.
-  when a line is inserted into the listing the line numbers no
-  longer match up. This accounts for that. 
-  */
-  int insert_offset = 0;
+    Format a listing entry into the text that will be written to the listing file
+    */
+  std::string formatListing(ListingEntry &e);
 
 public:
   /*
@@ -63,12 +234,56 @@ public:
     */
   std::vector<std::string> pc_list;
 
+  /*
+    The names of the processes in the same order as pc_list
+    */
+  std::vector<std::string> process_names;
+
   /*
     This contains all of the instructions that have been defined in the program.
     Each instruction is stored as a 32 bit hex number in string format.
     */
   std::vector<std::string> ins_list;
 
+  /*
+    Extra information about every instruction in ins_list, in the same order.
+    */
+  std::vector<InstructionInfo> ins_info;
+
+  /*
+    The .rodata strings placed in data RAM so far and their addresses. A later 
+    .rodata string that is the same as one of these, or the end of one, shares its bytes.
+    */
+  std::vector<std::pair<std::string, int>> string_pool;
+
+  /*
+    The .local buffers declared in the program, in the order they were found
+    */
+  std::vector<LocalData> locals;
+
+  /*
+    The .vreg registers declared in the program, in the order they were found
+    */
+  std::vector<VirtualRegister> vregs;
+
+  /*
+    The hints given in the program, in the order they were found
+    */
+  std::vector<Hint> hints;
+
+  /*
+    The process that declared each register in reg_list and each byte in data_list, 
+    as an index in pc_list, or -1 for those declared outside of a process
+    */
+  std::vector<int> reg_process;
+  std::vector<int> data_process;
+
+  /*
+    The macro written on each source line that has one. The instructions made from 
+    the line can be found through their line_number, wherever they are moved to.
+    */
+  std::map<int, std::string> macro_lines;
+
   /*
     This is the number of processes that are defined in the program.
     This number should always be >= 7 when a project is finished building.
@@ -89,21 +304,44 @@ public:
     int location        - The memory location of the instruction or assignment
     std::string data    - the data to listing
     std::string line    - the line which produced the data
+    int kind            - what the location refers to, one of listing_kinds
     */
-  void log(int ln, int location, std::string data, std::string line);
+  void log(int ln, int location, std::string data, std::string line, int kind = LISTING_TEXT);
 
   /*
     Add data to the assembly listing. This will format the data passed to it
     into a human readable assembly listing output. This will insert a new 
-    string into the listing at the location requested and push all other data
-    down one place
+    entry in front of the line requested, after any entries that have already
+    been inserted there.
 
     int ln              - The line number which we are inserting
     int location        - The memory location of the instruction or assignment
     std::string data    - the data to listing
     std::string line    - the line which produced the data
+    int kind            - what the location refers to, one of listing_kinds
+    */
+  void insertLog(int ln, int location, std::string data, std::string line, int kind = LISTING_TEXT);
+
+  /*
+    Gives access to the listing so that passes that move instructions can update it.
+    */
+  std::vector<ListingLine> &getListing();
+
+  /*
+    Add a register to reg_list
+
+    std::string value - the starting value of the register as a 16 bit hex string
+    int process       - the index in pc_list of the process that declared it, -1 for none
     */
-  void insertLog(int ln, int location, std::string data, std::string line);
+  void addRegister(std::string value, int process);
+
+  /*
+    Add a byte to data_list
+
+    std::string value - the starting value of the byte as an 8 bit hex string
+    int process       - the index in pc_list of the process that declared it, -1 for none
+    */
+  void addData(std::string value, int process);
 
   /*
     Create the listing file on the disk. Contents of the listing file will be the contents of the asm_listing
@@ -113,6 +351,11 @@ public:
     */
   void createListingFile(std::string dir);
 
+  /*
+    The text of the listing file
+    */
+  std::string listingText();
+
   /*
     Create the program instructions file on the disk.
 
@@ -154,6 +397,25 @@ public:
     std::string dir     - the name of the file to be created.
     */
   void createConfigFile(std::string dir);
+
+  /*
+    The text of the config.v file
+    */
+  std::string configText();
+
+  /*
+    Create the Verilog file that holds the instruction and sequence memories that are
+    small enough to be built as ROMs, see Options::rom_size. Nothing is written when
+    neither memory is.
+
+    std::string name    - the name of the file to be created.
+    */
+  void createRomFile(std::string name);
+
+  /*
+    The text of the rom.v file, empty when there are no ROMs
+    */
+  std::string romText();
 };
 
 #endif
\ No newline at end of file
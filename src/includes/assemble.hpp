@@ -84,11 +84,35 @@ private:
   */
   void doProcess();
 
+  /*
+  Read the weight=N attribute that may follow the name of a process. The top level 
+  process is given N slots of the sequence RAM for every one given to a process with 
+  no weight.
+
+  std::string &name   - the name of the process as it was declared
+  */
+  void doWeight(std::string &name);
+
   /*
   Clears the name of the current process and in_process flag
   */
   void doEndProcess();
 
+  /*
+  Store a hint such as .unroll against the current process so that the passes run 
+  after assembly can find it. A hint may be followed by a value.
+
+  Token &hint   - the token of the directive
+  */
+  void doHint(Token &hint);
+
+  /*
+  Add the pc_data entry that the idle slots of the sequence RAM run, after those of 
+  every process, pointing at a jump to itself placed after the last instruction. 
+  Running it again before its PC has been written back does no harm.
+  */
+  void addIdleProcess();
+
   /*
   Created a symbol that has been declared in the code.
   This could be .reg, .data or .const
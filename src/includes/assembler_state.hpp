@@ -40,6 +40,19 @@ class AssemblerState
     The number of registers that have been defined in this program
     */
     int register_count = 0;
+
+    /*
+    The register that .flag declarations are being packed into and the next
+    free bit in it. A new register is started when this one is full and at 
+    the start and end of each process, so flags are never shared by accident.
+    */
+    int flag_register = -1;
+    int flag_bit = 16;
+
+    /*
+    The number of .vreg registers declared in the current process
+    */
+    int vreg_count = 0;
     
     /*
     The number of data registers that have been defined in this program
@@ -0,0 +1,114 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#ifndef BUNDLE_HPP
+#define BUNDLE_HPP
+
+#include <string>
+#include <vector>
+
+/*
+A bundle holds every file the assembler writes in one little endian file.
+
+  header    "AVBN", version, section count and section alignment, 4 x 32 bits
+  index     one 64 byte entry for each section:
+              type, 32 bits
+              word width in bits, 32 bits, 0 for text
+              offset from the start of the file, 64 bits
+              length in bytes, 64 bits
+              FNV-1a hash of the contents, 64 bits
+              name of the file the section is written to, 32 bytes padded with 0
+  sections  each one starts on a multiple of the alignment so it can be mapped
+            straight into memory
+
+The images are raw little endian words and the text files are as they are written.
+*/
+namespace bundle
+{
+
+const std::string MAGIC = "AVBN";
+const int VERSION = 1;
+const int ALIGNMENT = 4096;
+const int HEADER_SIZE = 16;
+const int INDEX_ENTRY_SIZE = 64;
+const int NAME_SIZE = 32;
+
+/*
+The types of section
+*/
+enum section_types
+{
+  SECTION_INST = 1,
+  SECTION_DATA,
+  SECTION_PC,
+  SECTION_REG,
+  SECTION_SEQ,
+  SECTION_META,    // sequence_count, instruction_count, register_count, data_count and process_count as 32 bit words
+  SECTION_CONFIG,
+  SECTION_ROM,
+  SECTION_LISTING
+};
+
+/*
+Section
+
+A section of a bundle
+*/
+class Section
+{
+public:
+  int type = 0;
+  int width = 0;
+  std::string name;
+  std::vector<unsigned char> contents;
+};
+
+/*
+The 64 bit FNV-1a hash of some bytes, as kept in the index of a bundle
+*/
+unsigned long long hash(const std::vector<unsigned char> &b, std::size_t at, std::size_t length);
+
+/*
+Write the assembled program to a bundle. Returns false and prints why if it can not.
+
+std::string name      - the name of the bundle
+std::string listing   - the name of the listing file
+*/
+bool write(std::string name, std::string listing);
+
+/*
+Read the sections of a bundle. Returns false and prints why if the bundle can not be 
+read or a section does not match its hash.
+
+std::string name                  - the name of the bundle
+std::vector<Section> &sections    - the sections read
+*/
+bool read(std::string name, std::vector<Section> &sections);
+
+/*
+Write the files held in a bundle, under the names they had when it was made. The
+meta section is only printed. Returns false and prints why if the bundle can not 
+be read or a section does not match its hash.
+
+std::string name  - the name of the bundle
+bool quiet        - do not print the sections
+*/
+bool unbundle(std::string name, bool quiet);
+
+} // namespace bundle
+
+#endif
@@ -21,6 +21,7 @@
 #include "token_list.hpp"
 #include "assembler_state.hpp"
 #include "asm_data.hpp"
+#include "options.hpp"
 
 namespace data
 {
@@ -45,13 +46,33 @@ extern SymbolList symbol_list;
   */
 extern TokenList token_list;
 
+/*
+  The options the assembler was run with
+  */
+extern Options options;
+
 void setError(std::string s);
 
 void printError();
 
-void log(std::string s);
+/*
+  Add an instruction to the program and log it against the current line.
 
-void logMacro(std::string s);
+  std::string s   - the instruction as a 32 bit hex string
+  bool address    - true if the immediate of this instruction is the address of a label
+  */
+void log(std::string s, bool address = false);
+
+/*
+  Add an instruction that is part of a macro expansion to the program. The instruction
+  is inserted into the listing in front of the current line.
+
+  std::string s     - the instruction as a 32 bit hex string
+  std::string line  - the text to show in the listing next to the instruction
+  bool address      - true if the immediate of this instruction is the address of a label
+  bool table        - true if the instruction is part of a jump table made by switch
+  */
+void logMacro(std::string s, std::string line, bool address = false, bool table = false);
 
 } // namespace data
 
@@ -66,9 +66,37 @@ int getSizeAndValue(int &size, int &val, Token &tok);
 
 
 void createConst();
-void createData();
+
+/*
+  Creates a .data or .rodata declaration. Read only strings are pooled, one that 
+  matches an earlier read only string, or the end of one, is given the address of
+  those bytes rather than a copy of its own.
+
+  bool read_only  - true for .rodata
+  */
+void createData(bool read_only = false);
 void createReg();
 
+/*
+  .local routine name [size] declares a scratch buffer of the subroutine that starts 
+  at the label routine. Its address is given out by overlay::layout() once the whole
+  program has been read.
+  */
+void createLocal();
+
+/*
+  .vreg name declares a register of the current process that the register allocator
+  places once the program has been assembled. It shares a real register with any 
+  other .vreg of the process whose value is never needed at the same time.
+  */
+void createVreg();
+
+/*
+  .flag name declares a single bit flag. Flags are packed 16 to a register so
+  they can be set, cleared and tested with the bit instructions.
+  */
+void createFlag();
+
 
 } // namespace data_type
 
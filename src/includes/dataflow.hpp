@@ -0,0 +1,195 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#ifndef DATAFLOW_HPP
+#define DATAFLOW_HPP
+
+#include <vector>
+#include <bitset>
+#include <map>
+#include "program.hpp"
+
+namespace dataflow
+{
+
+/*
+Values a register can hold during constant analysis. Anything from 0 to 0xffff is a
+known constant, VALUE_ADDRESS + id is the address of the node with that id.
+*/
+const int VALUE_UNDEF = -2;
+const int VALUE_NAC = -1;
+const int VALUE_ADDRESS = 0x100000;
+
+const int REGISTER_COUNT = 256;
+
+typedef std::vector<int> Values;
+typedef std::bitset<REGISTER_COUNT> Registers;
+
+/*
+Returns true if the value is a plain 16 bit constant
+*/
+bool isConstant(int v);
+
+/*
+Look through the whole program for the registers each process reads and writes, 
+the registers used as pointers and the places that can be jumped to from outside 
+of a process. This must be called after program::load() and before any Analysis 
+is made. Given a process, only that process is looked at and the others are taken 
+to touch nothing. This is used while the same register numbers still stand for 
+different .vreg registers in each process.
+*/
+void scan(int process = -1);
+
+/*
+Registers that are read or written by any process other than the one given
+*/
+Registers foreignReads(int process);
+Registers foreignWrites(int process);
+
+/*
+The registers a node names as the ones it reads and the ones it writes, leaving out
+any that it reaches through a pointer
+*/
+Registers namedUses(program::Node &n);
+Registers namedDefs(program::Node &n);
+
+/*
+Analysis
+
+Def/use information, constant values and liveness for the registers of one process.
+The analysis works on single nodes rather than basic blocks, positions used here are
+positions in the process's node list.
+
+Registers that another process writes are never treated as constants and registers
+that another process reads are always live. Registers 0, 1 and 2 are taken to hold
+0, 1 and 0xffff as long as nothing in the program writes to them.
+*/
+class Analysis
+{
+public:
+  Analysis(program::Code &c);
+
+  program::Code &code;
+
+  /*
+  Successor positions of every node. A successor equal to the number of nodes means
+  the node falls through the end of the process.
+  */
+  std::vector<std::vector<int>> succ;
+
+  /*
+  Nodes that may jump somewhere that is not known (jalr, or a register jump whose
+  register does not hold a known label)
+  */
+  std::vector<bool> unknown_exit;
+
+  /*
+  Nodes that may be reached from somewhere that is not known
+  */
+  std::vector<bool> unknown_entry;
+
+  /*
+  Constant value of every register on entry to each node
+  */
+  std::vector<Values> in;
+
+  /*
+  Registers that are live before and after each node
+  */
+  std::vector<Registers> live_in;
+  std::vector<Registers> live_out;
+
+  /*
+  Nodes that can be reached from the start of the process
+  */
+  std::vector<bool> reachable;
+
+  Registers foreign_read;
+  Registers foreign_write;
+
+  /*
+  Position of the node with the given id, or -1
+  */
+  int position(int id);
+
+  /*
+  Position of the node a jump at position i goes to, -1 if not known
+  */
+  int jumpTarget(int i);
+
+  /*
+  Returns 1 if the conditional jump at position i is always taken, 0 if it is never 
+  taken and -1 if that is not known or the node is not a conditional jump.
+  */
+  int branch(int i);
+
+  /*
+  Run the constant and liveness analysis
+  */
+  void run();
+
+  /*
+  Apply the effect of the node at position i to the register values v
+  */
+  void transfer(int i, Values &v);
+
+  /*
+  The result of the ALU node at position i given the register values v
+  */
+  int evaluate(int i, Values &v);
+
+  /*
+  Registers read by the node at position i given the values on entry to it
+  */
+  Registers uses(int i, Values &v);
+
+  /*
+  Registers that are certainly written by the node at position i
+  */
+  Registers defs(int i, Values &v);
+
+  /*
+  Registers that may be written by the node at position i
+  */
+  Registers mayDefs(int i, Values &v);
+
+  /*
+  True if removing the node at position i can only change the value of registers
+  */
+  bool sideEffectFree(int i, Values &v);
+
+private:
+  std::map<int, int> positions;
+  std::vector<int> resolved;
+
+  /*
+  The positions of the entries of the jump table a switch jalr indexes into, the 
+  entries are always placed directly after the jalr
+  */
+  std::vector<std::vector<int>> tables;
+  std::vector<bool> fixed;
+  Values initial;
+
+  void buildGraph();
+  void constants();
+  void liveness();
+
+  void set(Values &v, int reg, int value);
+};
+
+} // namespace dataflow
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#ifndef DELTA_HPP
+#define DELTA_HPP
+
+#include <string>
+
+/*
+A delta holds the words that changed in each memory image between two builds, so a
+loader only has to write those. It is written as text to delta.txt and as little 
+endian binary to delta.avd:
+
+  header    "AVBD", version and the number of images, 3 x 32 bits
+  images    for each image:
+              type, as the bundle section types, 32 bits
+              word width in bits, 32 bits
+              words in the base image, 32 bits
+              FNV-1a hash of the base image, 64 bits
+              words in the new image, 32 bits
+              FNV-1a hash of the new image, 64 bits
+              number of ranges, 32 bits
+            then for each range the address of its first word and its number of
+            words, 2 x 32 bits, followed by the new words
+
+A loader should check the hash of the image it holds against the base hash before 
+it writes a delta, and the hash of the result against the new hash afterwards.
+*/
+namespace delta
+{
+
+const std::string MAGIC = "AVBD";
+const int VERSION = 1;
+
+/*
+The bytes taken by the address and length of a range in the binary delta. Two ranges
+with no more than this many unchanged bytes between them are written as one.
+*/
+const int RANGE_HEADER_SIZE = 8;
+
+/*
+Work out the delta from one build to another and write it to delta.txt and delta.avd.
+Each build is a bundle made with -b or a directory holding the images as the assembler
+writes them, under the names given by -d, -p, -l, -r and -s. Returns false and prints
+why if either build can not be read.
+
+std::string base    - the build on the device
+std::string next    - the build to change it to
+bool quiet          - do not print the size of the delta
+*/
+bool diff(std::string base, std::string next, bool quiet);
+
+} // namespace delta
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#ifndef IMAGE_HPP
+#define IMAGE_HPP
+
+#include <string>
+#include <vector>
+
+namespace image
+{
+
+/*
+The formats a memory image can be written in
+*/
+enum image_formats
+{
+  FORMAT_HEX,  // one hex word to a line, as read by $readmemh
+  FORMAT_BIN,  // raw little endian binary
+  FORMAT_IHEX, // Intel HEX, byte addressed with the bytes of each word little endian
+  FORMAT_COE,  // Xilinx coefficient file
+  FORMAT_MEM,  // Xilinx updatemem file with an address on every line
+  FORMAT_MIF   // Altera memory initialisation file
+};
+
+/*
+The names of the images that can be given a format of their own with -F
+*/
+const std::string IMAGE_INST = "inst";
+const std::string IMAGE_DATA = "data";
+const std::string IMAGE_PC = "pc";
+const std::string IMAGE_REG = "reg";
+const std::string IMAGE_SEQ = "seq";
+
+/*
+Returns the format with the given name, one of hex, bin, ihex, coe, mem or mif, or -1
+if there is none
+*/
+int parseFormat(const std::string &name);
+
+/*
+Returns the format an image is to be written in, from the options
+*/
+int formatOf(const std::string &image);
+
+/*
+The words of an image as raw little endian binary
+
+const std::vector<std::string> &words - the words of the image as hex strings
+int width                             - the width of a word in bits, a multiple of 8
+*/
+std::vector<unsigned char> toBinary(const std::vector<std::string> &words, int width);
+
+/*
+The words of an image from raw little endian binary, as hex strings in the form they
+are written to the $readmemh files
+
+const std::vector<unsigned char> &binary  - the image
+int width                                 - the width of a word in bits, a multiple of 8
+*/
+std::vector<std::string> fromBinary(const std::vector<unsigned char> &binary, int width);
+
+/*
+Write a memory image. Every format other than FORMAT_HEX adds its own extension to
+the name, .bin, .hex, .coe, .mem or .mif, so the file $readmemh loads is never 
+written in another format by mistake.
+
+std::string name                      - the name of the file
+const std::vector<std::string> &words - the words of the image as hex strings
+int width                             - the width of a word in bits, a multiple of 8
+int format                            - one of image_formats
+*/
+void write(std::string name, const std::vector<std::string> &words, int width, int format);
+
+} // namespace image
+
+#endif
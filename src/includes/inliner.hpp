@@ -0,0 +1,59 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#ifndef INLINER_HPP
+#define INLINER_HPP
+
+namespace inliner
+{
+
+/*
+Counts of the changes the inliner made
+*/
+class Report
+{
+public:
+  int inlined = 0;
+  int tail_calls = 0;
+  int added = 0;
+  int skipped = 0;
+};
+
+extern Report report;
+
+/*
+Replace calls to small leaf subroutines with a copy of the subroutine. A subroutine can
+be inlined when it makes no calls of its own, every way out of it is a ret through the 
+register the call linked into, nothing else in it touches that register and the 
+register is not read after the call returns. Subroutines of up to the inline size, and
+any written after an .inline hint, are inlined until the program reaches the inline
+budget. A subroutine written after a .noinline hint is never inlined.
+
+A call that is directly followed by a ret through another register is turned into a 
+move of the return address into the link register and a jump, so the subroutine 
+returns straight to the caller's caller. This is only done when the link register is
+used for nothing but calls and returns.
+*/
+void inlineCalls();
+
+/*
+Print what the inliner did to the screen
+*/
+void printReport();
+
+} // namespace inliner
+
+#endif
@@ -76,6 +76,14 @@ void getALUReg(Symbol &sym, int & command);
     */
 int getImmValue();
 
+/*
+    As above but also reports if the immediate was a label, so that the value is the 
+    address of an instruction.
+
+    bool &address   - set to true if the immediate was a label
+    */
+int getImmValue(bool &address);
+
 /*
 Creates an instruction for an ALU opcode where the destination or source can be indirect
 
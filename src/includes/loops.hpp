@@ -0,0 +1,131 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#ifndef LOOPS_HPP
+#define LOOPS_HPP
+
+#include <vector>
+#include "dataflow.hpp"
+
+namespace loops
+{
+
+/*
+Loop
+
+A natural loop of a process. It is entered through its head and every node in it can
+get back to the head without leaving the loop.
+*/
+class Loop
+{
+public:
+  /*
+  Position of the head of the loop
+  */
+  int head = -1;
+
+  /*
+  Positions of the nodes that jump back to the head
+  */
+  std::vector<int> tails;
+
+  /*
+  body[i] is true if the node at position i is part of the loop
+  */
+  std::vector<bool> body;
+
+  /*
+  Number of nodes in the loop
+  */
+  int size = 0;
+};
+
+/*
+Work out the dominators of every reachable node of the analysed process. The result 
+dom[i][j] is true if every way of getting to position i goes through position j.
+
+dataflow::Analysis &a   - an analysis that has been run
+*/
+std::vector<std::vector<bool>> dominators(dataflow::Analysis &a);
+
+/*
+Find the natural loops of the analysed process from its back edges. A back edge is a 
+jump to a node that dominates the jump. Loops are returned smallest first so inner 
+loops come before the loops around them.
+
+dataflow::Analysis &a                   - an analysis that has been run
+std::vector<std::vector<bool>> &dom     - the dominators from dominators()
+*/
+std::vector<Loop> findLoops(dataflow::Analysis &a, std::vector<std::vector<bool>> &dom);
+
+/*
+Returns the number of times a djnz loop goes round when its counter holds a known 
+value every way into the loop, or 0 if that is not known.
+
+dataflow::Analysis &a   - an analysis that has been run
+Loop &l                 - a loop of the analysed process
+*/
+int tripCount(dataflow::Analysis &a, Loop &l);
+
+/*
+Counts of the changes the loop passes made
+*/
+class Report
+{
+public:
+  int loops = 0;
+  int hoisted = 0;
+  int renamed = 0;
+  int unrolled = 0;
+  int added = 0;
+  int skipped = 0;
+
+  /*
+  Lines of the .unroll hints that were not found in front of any loop
+  */
+  std::vector<int> ignored;
+};
+
+extern Report report;
+
+/*
+Move ldi and ALU instructions whose result is the same every time round a loop out 
+of the loop and into a preheader placed in front of the loop head. A label load into
+a shared macro register (as made by jeq, jbs and the like) is moved to a register of 
+its own, made with getMacroRegister, so that it can be hoisted as well.
+*/
+void hoist();
+
+/*
+Unroll djnz loops whose counter holds a known value when the loop is entered. A loop 
+after an .unroll hint is unrolled fully, or by the factor given with the hint, as long
+as the program still fits in the instruction memory. When an unroll budget is set other
+loops are unrolled fully if the program stays within the budget, or else by the largest 
+factor that does. Iterations that do not fit a whole number of times are placed in 
+front of the loop.
+
+The decrement is removed along with the jump unless the loop reads its counter.
+*/
+void unroll();
+
+/*
+Print what the loop passes did to the screen
+*/
+void printReport();
+
+} // namespace loops
+
+#endif
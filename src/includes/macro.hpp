@@ -80,6 +80,37 @@ void macroJeq(int command);
 void macroJbs(int commnad);
 void macroJle(int command);
 
+/*
+  mul, div and mod of a register by a constant. The constant must be known when the 
+  macro is first seen as the number of instructions made depends on it.
+
+  std::string m  - the name of the macro
+  */
+void macroArithmetic(std::string m);
+
+/*
+  memcpy and memset of a block of data RAM. The count and the optional unroll factor 
+  must be known when the macro is first seen.
+
+  std::string m  - the name of the macro
+  */
+void macroBlock(std::string m);
+
+/*
+  switch index, label0, label1, ... jumps to the label picked by the index register 
+  through a table of jumps, or carries on after the table if the index is past its end.
+  */
+void macroSwitch();
+
+/*
+  setf and clrf set or clear a flag, jfs and jfc jump if it is set or clear. The flag 
+  is a .flag name or reg:bit and the work is done by setb, clrb, jbsr and jbcr.
+
+  int command  - the bit instruction that the macro is made from
+  */
+void macroSetf(int command);
+void macroJfs(int command);
+
 } // namespace instructions
 
 #endif
\ No newline at end of file
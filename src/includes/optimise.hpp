@@ -0,0 +1,58 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#ifndef OPTIMISE_HPP
+#define OPTIMISE_HPP
+
+namespace optimise
+{
+
+/*
+Counts of the changes the optimiser made
+*/
+class Report
+{
+public:
+  int before = 0;
+  int after = 0;
+  int folded = 0;
+  int jumps = 0;
+  int removed = 0;
+};
+
+extern Report report;
+
+/*
+Run the dataflow optimiser over every process in program::code. Within each 
+process register values that are known are folded into ldi instructions, ldi of a value 
+a register already holds is removed, jumps that always or never go are replaced or 
+removed, code that can not be reached is removed and writes to registers that are 
+never read again are removed. Registers used by more than one process are never 
+treated as constants or as dead. 
+
+As instructions are removed the timing of a process changes, nop instructions and 
+anything that touches a port are always left in place.
+*/
+void optimise();
+
+/*
+Print what the optimiser did to the screen
+*/
+void printReport();
+
+} // namespace optimise
+
+#endif
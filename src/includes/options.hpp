@@ -17,6 +17,7 @@
 #ifndef OPTIONS_CPP
 #define OPTIONS_CPP
 
+#include <map>
 #include <string>
 
 /**
@@ -36,6 +37,110 @@ class Options
     bool help = false;
     bool version = false;
     bool quiet = false;
+    bool optimise = false;
+    bool hoist = false;
+
+    /*
+    The most instructions the program may grow to when loops are unrolled automatically,
+    0 turns automatic unrolling off
+    */
+    int unroll_budget = 0;
+
+    /*
+    Subroutines of up to this many instructions are inlined at their calls, 0 turns
+    inlining off for subroutines without an .inline hint
+    */
+    int inline_size = 0;
+
+    /*
+    The most instructions the program may grow to when subroutines are inlined, 0 for 
+    the size of the instruction memory
+    */
+    int inline_budget = 0;
+
+    /*
+    The number of words memcpy and memset write each time round their loop when no
+    unroll factor is given with the macro
+    */
+    int block_unroll = 8;
+
+    /*
+    When the exact sequence RAM does not fit, the percentage each process's share of
+    the sequence may be off by in the shorter one built instead. 0 turns this off.
+    */
+    int sequence_tolerance = 0;
+
+    /*
+    Interleave the sequence RAM so the gaps between runs of each process are as even
+    as they can be
+    */
+    bool min_jitter = false;
+
+    /*
+    The clock in MHz to report the timing of each process at, 0 turns the timing 
+    report off
+    */
+    double timing_clock = 0;
+
+    /*
+    Work out the longest time each process can take between its .mark points and show
+    the cycles taken by every instruction in the listing
+    */
+    bool wcet = false;
+
+    /*
+    A trace of PC samples taken from the processor to map back to the source and show
+    in the listing, empty for none
+    */
+    std::string profile_file;
+
+    /*
+    The number of instructions, registers and bytes of data RAM the processor is built
+    with. A program that needs more than this fails to build.
+    */
+    int imem_size = 1024;
+    int reg_size = 256;
+    int dmem_size = 1024;
+
+    /*
+    Print how much of each memory is used by each process and by each macro
+    */
+    bool usage = false;
+
+    /*
+    The instruction and sequence memories of at most this many words are written to 
+    rom.v as case ROMs instead of being loaded into RAM from their data files. 0 turns 
+    this off.
+    */
+    int rom_size = 0;
+
+    /*
+    The format the memory images are written in and the formats given to single 
+    images, by image name, see image.hpp
+    */
+    std::string image_format = "hex";
+    std::map<std::string, std::string> image_formats;
+
+    /*
+    A bundle to write every output file to as well, and a bundle to write the files
+    back out of instead of assembling a program, empty for none
+    */
+    std::string bundle_file;
+    std::string unbundle_file;
+
+    /*
+    The build on the device to make a delta from, to the build given in place of the 
+    input file, empty for none
+    */
+    std::string delta_base;
+
+    /*
+    The layout map to keep processes at the addresses of the last build with, and 
+    rewrite for the next one, empty for none. The words of room to grow given to a 
+    process that has to be placed afresh.
+    */
+    std::string pin_file;
+    int slack = 0;
 
     /*
     Process the command line options
@@ -44,6 +149,12 @@ class Options
     char **av   - pointers to the options and values
     */
     void processOptions(int ac, char **av);
+
+    /*
+    Set the format of the images from the value given to -F, either a format for all
+    of them or image=format for one of them
+    */
+    void setFormat(std::string s);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,67 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#ifndef OVERLAY_HPP
+#define OVERLAY_HPP
+
+namespace overlay
+{
+
+/*
+Sizes of the .local buffers and of the data RAM they were placed in
+*/
+class Report
+{
+public:
+  int locals = 0;
+  int size = 0;
+  int used = 0;
+};
+
+extern Report report;
+
+/*
+Note a call found while the program is first read. The tokens after call or jal 
+are read to find the link register and the label called.
+*/
+void addCall();
+
+/*
+Note a ret, or any other jalr, found while the program is first read
+*/
+void addReturn();
+
+/*
+Give every .local buffer its address. The call graph of each process is built from 
+the calls noted while reading the program. A subroutine runs from its label to the 
+last ret before the next subroutine that is called, calls in between belong to it and 
+anything else belongs to the process itself. The buffers of a subroutine are placed
+above those of every subroutine that can call it, so subroutines that are never on the 
+call chain at the same time share data RAM. Each process gets a region of its own after 
+all of the .data as the processes run at the same time.
+
+This must be called after the first pass and before the second.
+*/
+void layout();
+
+/*
+Print how much data RAM the .local buffers take to the screen
+*/
+void printReport();
+
+} // namespace overlay
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#ifndef PIN_HPP
+#define PIN_HPP
+
+#include <string>
+
+namespace pin
+{
+
+/*
+Lay out the processes of the finished program against the layout map of the last 
+build. A process that still fits in the slot it had is left where it was, so its 
+code, its entry in pc_data and everything it jumps to keep their addresses. A process
+that has grown past its slot, or is new, is moved to the first gap that is big enough
+for it, the slot of a process that has gone or moved, or else after the last slot. 
+Gaps are filled with padding. Each process that is placed afresh is given 
+Options::slack words of room to grow.
+
+The map is a text file with a line for each process, its name, its start address 
+and the size of its slot, and is read from Options::pin_file if it exists.
+
+This must be called after program::load() on the finished program.
+*/
+void layout();
+
+/*
+Write the layout map of the program for the next build to pin against
+
+std::string name  - the name of the map
+*/
+void writeMap(std::string name);
+
+/*
+Print the number of processes that were kept in place and moved, and the padding used
+*/
+void printReport();
+
+} // namespace pin
+
+#endif
@@ -19,7 +19,14 @@
 
 #include <map>
 #include <vector>
+#include <string>
 
+/*
+The fewest slots of the sequence RAM after which a pc_data entry may come round again.
+The PC a slot writes back comes out of the end of the pipeline 6 cycles after it was 
+read, so an entry that comes round any sooner runs the same instruction again.
+*/
+const int SEQUENCE_MIN_GAP = 7;
 
 class ProcessData
 {
@@ -32,6 +39,11 @@ class ProcessData
     std::vector<int> locs;
     std::vector<int>::iterator loc_pos;
 
+    /*
+    The weight given with weight=N, 0 if none was given
+    */
+    int weight = 0;
+
     /*
     Create a process data object with the name of the found process and location of its pc_data entry in the pc ram.
     */
@@ -47,6 +59,11 @@ class ProcessData
     */
     int getNumberOfSplits(void);
 
+    /*
+    Return the number of slots this process has in each round of the sequence RAM
+    */
+    int getWeight(void);
+
     /*
     get the name of this top level process
     */
@@ -68,6 +85,7 @@ class ProcessData
     /*
     Gets the next ram location for the sequence file
     */
+    int getNextLocation(void);
     std::string getNextLocationOutput(void);
 
 
@@ -109,9 +127,141 @@ bool doesTopLevelProcessExist(std::string &name);
 /*
 returns the LCM for the processes that have been defined in this program. 
 This is how many itterations that the seq data will need to create a loop.
+A process with a weight moves on through its splits once per slot, so it only
+needs the splits divided by what they have in common with the weight.
 */
 int getLCMForSeqData(void);
 
+/*
+The number of slots in each round of the sequence RAM, the sum of the weights of 
+the top level processes
+*/
+int getSlotsPerRound(void);
+
+/*
+The number of entries in the sequence RAM
+*/
+int getSequenceLength(void);
+
+/*
+SequenceShare
+
+The share of the sequence RAM asked for by a process, or a part of a split process, 
+and the share it got in an approximate sequence.
+*/
+class SequenceShare
+{
+public:
+  std::string name;
+  int location = 0;
+  double requested = 0;
+  int slots = 0;
+};
+
+/*
+SequenceRevisit
+
+How often a process, or a part of a split process, comes round in the sequence RAM.
+worst and was are the longest gaps between its slots after and before it was 
+interleaved by smoothSequence().
+*/
+class SequenceRevisit
+{
+public:
+  std::string name;
+  int location = 0;
+  int slots = 0;
+  int worst = 0;
+  int was = 0;
+};
+
+/*
+The sequence RAM as pc_data locations when it has been built by buildApproximateSequence()
+or smoothSequence(), empty when the exact sequence is written round by round.
+*/
+extern std::vector<int> sequence;
+extern std::vector<SequenceShare> sequence_shares;
+extern std::vector<SequenceRevisit> sequence_revisits;
+
+/*
+Build the shortest sequence RAM, of no more than max entries, in which every process 
+and every part of a split process gets its share of the slots to within tolerance 
+percent. The slots each one gets are spread through the sequence with no entry coming 
+round again in fewer than SEQUENCE_MIN_GAP slots. This is used when the exact sequence 
+made from the LCM of the splits is too long.
+
+returns true if such a sequence was found.
+*/
+bool buildApproximateSequence(int tolerance, int max);
+
+/*
+When the weights of the processes bring a pc_data entry round again in fewer than 
+SEQUENCE_MIN_GAP slots of the exact sequence, build the shortest sequence RAM, of no
+more than max entries, that gives every entry as many slots and keeps them far enough
+apart. The slots left over go to the idle entry. Nothing is done if the exact 
+sequence is already far enough apart.
+
+returns false if there is no such sequence.
+*/
+bool spaceSequence(int max);
+
+/*
+The pc_data entry that the idle slots of the sequence RAM run, the one after those of
+every process. It has to be given a PC that points at a jump to itself.
+*/
+int getIdleLocation(void);
+
+/*
+Returns true if the sequence RAM has idle slots
+*/
+bool sequenceHasIdle(void);
+
+/*
+Print the shares asked for and given in the approximate sequence to the screen
+*/
+void printSequenceReport(void);
+
+/*
+Reorder the slots of the sequence RAM, keeping its length and how many slots each process
+and each part of a split process gets, so that the longest gap between two runs of each
+one is as short as it can be made without any of them coming round again in fewer than
+SEQUENCE_MIN_GAP slots.
+*/
+void smoothSequence(void);
+
+/*
+Print the average and worst gaps between runs of each process after smoothSequence()
+*/
+void printRevisitReport(void);
+
+/*
+The sequence RAM as it is written to the sequence file, as pc_data locations
+*/
+std::vector<int> getSequence(void);
+
+/*
+Print the slots each process and each part of a split process gets in the sequence RAM,
+the average and worst number of cycles between its runs and the instructions per second
+it gets with a clock of mhz. A slot that comes round fewer than SEQUENCE_MIN_GAP cycles
+after the last one that ran a new instruction runs that instruction again, so it is not
+counted in the instructions per second and the line says how many there are a round.
+*/
+void printTimingReport(double mhz);
+
+/*
+The most clock cycles that n instructions of the process at location in pc_data can take, 
+from the start of the slot the first one runs in to the next slot of the process after 
+the last one, wherever in the sequence RAM they start.
+*/
+long long getWorstCycles(int location, long long n);
+
+/*
+The order the top level processes are given slots in within one round, as indexes 
+into p_list. A process with weight N appears N times, spread as evenly through the 
+round as the other weights allow. With no weights this is the order of p_list.
+*/
+std::vector<int> getRoundOrder(void);
+
 /*
 Create a new ProcessData object and add it to the list.
 */
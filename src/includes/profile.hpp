@@ -0,0 +1,76 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <string>
+#include <vector>
+
+namespace profile
+{
+
+/*
+Spot
+
+A source line, label or macro and the number of PC samples that fell in it
+*/
+class Spot
+{
+public:
+  std::string name;
+  long long samples = 0;
+};
+
+/*
+The samples taken, and how many of them were at a PC outside the program or in the 
+code of a different process to the one the sample was taken from
+*/
+extern long long total;
+extern long long outside;
+extern long long foreign;
+
+/*
+The hot spots, busiest first
+*/
+extern std::vector<Spot> lines;
+extern std::vector<Spot> labels;
+extern std::vector<Spot> macros;
+
+/*
+Read a trace of PC samples and map each one back to the source line, label and macro 
+it came from. A line of the trace holds the process number and the PC, both in hex 
+as they are in pc_data, separated by spaces or a comma and optionally in brackets. 
+Blank lines and lines starting with ; or # are skipped.
+
+The instructions in the listing are given the share of the samples that fell on them.
+
+This must be called on the finished program as the trace is only meaningful for the 
+program that it was taken from.
+
+std::string name  - the trace file
+*/
+void load(std::string name);
+
+/*
+Print the busiest source lines, labels and macros to the screen
+*/
+void printReport();
+
+} // namespace profile
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#ifndef PROGRAM_HPP
+#define PROGRAM_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+
+/*
+The indirection bits of an opcode. For ALU instructions bit 7 makes Rd a pointer
+and bit 6 makes Rs2 a pointer. The register jumps always have bit 7 set as their 
+Rd holds the jump address.
+*/
+const int OPCODE_RD_INDIRECT = 0x80;
+const int OPCODE_RS2_INDIRECT = 0x40;
+
+/*
+The word written to instruction memory that belongs to no process, the nop
+*/
+const std::string PADDING = "00000000";
+
+namespace program
+{
+
+/*
+Node
+
+A single instruction of the program in a form that passes can work on. The 
+16 bit immediate of a jump, or of an ldi that loads a label, is held as the id of
+the node it refers to so that nodes can be added, removed and moved without 
+breaking the addresses. The real addresses are put back by store().
+*/
+class Node
+{
+public:
+  /*
+  Unique id of this node, ids of loaded nodes are their index in ins_list
+  */
+  int id = -1;
+
+  int op = 0;
+  int rd = 0;
+  int rs1 = 0;
+  int rs2 = 0;
+
+  /*
+  The id of the node that the immediate points at, -1 if the immediate is not an address
+  */
+  int target = -1;
+
+  /*
+  True for an ldi that loads the address of a label
+  */
+  bool address = false;
+
+  /*
+  True for the entries of a jump table and the add and jalr that index into it. Passes 
+  must not remove, move or change these.
+  */
+  bool table = false;
+
+  /*
+  Index in ins_list of the instruction this node was loaded from, -1 if it was created by a pass
+  */
+  int ins = -1;
+
+  /*
+  Index in ins_list of the loaded instruction that this node is shown with in the listing
+  */
+  int anchor = -1;
+
+  /*
+  The source line that produced this node and the text shown for it in the listing
+  */
+  int line_number = 0;
+  std::string text;
+
+  /*
+  The 16 bit immediate of ldi, jal, jz and jnz
+  */
+  int imm();
+  void setImm(int v);
+};
+
+/*
+Code
+
+The instructions that belong to one process, in the order they are placed in memory.
+*/
+class Code
+{
+public:
+  /*
+  Index of the process in pc_list
+  */
+  int process = 0;
+
+  /*
+  Name of the process as it was declared
+  */
+  std::string name;
+
+  std::vector<Node> nodes;
+
+  /*
+  The id used by references to the address just past the last instruction of the process
+  */
+  int end_id = -1;
+
+  /*
+  Returns the position in nodes of the node with the given id, size() for the end
+  of the process and -1 if the id is not part of this process.
+  */
+  int indexOf(int id);
+};
+
+/*
+The code of every process in the program, in pc_list order
+*/
+extern std::vector<Code> code;
+
+/*
+Opcode helpers. The register jumps are decoded from bits 5 to 0 of the opcode, bit 6 
+makes the value they test indirect.
+*/
+bool isALU(int op);
+bool isBitOp(int op);
+bool isLDI(int op);
+bool isJAL(int op);
+bool isJZ(int op);
+bool isJALR(int op);
+bool isRegisterJump(int op);
+bool isConditionalJump(int op);
+
+/*
+Returns true if the immediate of the node holds the address of an instruction
+*/
+bool hasAddress(Node &n);
+
+/*
+Create a new node that is not loaded from the program
+*/
+Node makeNode(int op, int rd, int rs1, int rs2);
+
+/*
+Remove the node at index from the code. Anything that referred to the removed node 
+will refer to the node that followed it instead.
+*/
+void removeNode(Code &c, int index);
+
+/*
+Make everything that refers to the node with id refer to the node with id to instead.
+This is used when a node is replaced by a copy of itself.
+*/
+void redirect(int id, int to);
+
+/*
+Insert a node into the code in front of the node at index
+*/
+void insertNode(Code &c, int index, Node n);
+
+/*
+Returns the id that now stands in for the given id after nodes have been removed.
+*/
+int resolve(int id);
+
+/*
+Returns the index in data::data.hints of the hint with the given name that is written 
+directly in front of the node at position i, with no other code in between, or -1
+if there is none.
+*/
+int findHint(Code &c, int i, const std::string &name);
+
+/*
+Returns true if the program has any hints with the given name
+*/
+bool hasHint(const std::string &name);
+
+/*
+Build the node lists from the assembled program held in data::data.
+*/
+void load();
+
+/*
+Place the nodes back in memory and rebuild ins_list, ins_info, pc_list and the 
+addresses shown in the listing. Each process follows the one before it unless it is
+given an address of its own, any gaps left are filled with PADDING.
+
+const std::map<int, int> &origins - the address to start a process at, by its index
+                                     in pc_list
+*/
+void store(const std::map<int, int> &origins = std::map<int, int>());
+
+} // namespace program
+
+#endif
@@ -93,16 +93,40 @@ const std::string MACRO_JGE = "jge";
 const std::string MACRO_LD = "ld";
 const std::string MACRO_ST = "st";
 const std::string MACRO_MOV = "mov";
+const std::string MACRO_MUL = "mul";
+const std::string MACRO_DIV = "div";
+const std::string MACRO_MOD = "mod";
+const std::string MACRO_MEMCPY = "memcpy";
+const std::string MACRO_MEMSET = "memset";
+const std::string MACRO_SWITCH = "switch";
+const std::string MACRO_SETF = "setf";
+const std::string MACRO_CLRF = "clrf";
+const std::string MACRO_JFS = "jfs";
+const std::string MACRO_JFC = "jfc";
 
 /*
 The data types that can be defined
 */
 const std::string REG = ".reg";
+const std::string VRG = ".vreg";
 const std::string CON = ".const";
 const std::string DAT = ".data";
+const std::string ROD = ".rodata";
+const std::string LOC = ".local";
+const std::string FLG = ".flag";
 
 const std::string PROC = "process";
 const std::string EPROC = "endprocess";
+const std::string WEIGHT = "weight=";
+
+/*
+Hints that can be given to the assembler about the code that follows them
+*/
+const std::string UNROLL = ".unroll";
+const std::string INLINE = ".inline";
+const std::string NOINLINE = ".noinline";
+const std::string LOOPBOUND = ".loopbound";
+const std::string MARK = ".mark";
 
 /*
 Values denoting what types of token can be found
@@ -126,7 +150,12 @@ enum Types
   STRING,
   LABEL,
   OPERATOR,
-  ARRAY
+  ARRAY,
+  HINT,
+  FLAG,
+  RODATA,
+  VREG,
+  LOCAL
 };
 
 class Token
@@ -160,8 +189,12 @@ private:
   /*
    Check for a directive to the compiler.
    .reg     - a register declaration
+   .vreg    - a register that the assembler places
    .data    - a data declatation
+   .rodata  - a read only data declaration
+   .local   - scratch data belonging to a subroutine
    .const   - aconstant value
+   .flag    - a single bit flag
    */
   int checkType(void);
 
@@ -0,0 +1,84 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#ifndef WCET_HPP
+#define WCET_HPP
+
+#include <string>
+#include <vector>
+
+namespace wcet
+{
+
+/*
+Where the longest path from a .mark ends when it does not reach another .mark
+*/
+const int END_RETURN = -1;
+const int END_PROCESS = -2;
+const int END_LOOP = -3;
+
+/*
+Section
+
+The longest path found from one .mark point of a process
+*/
+class Section
+{
+public:
+  std::string process;
+
+  /*
+  The line of the .mark the path starts at and the line of the .mark it ends at, or
+  END_RETURN, END_PROCESS or END_LOOP
+  */
+  int from = 0;
+  int to = 0;
+
+  long long instructions = 0;
+  long long cycles = 0;
+
+  /*
+  The line of a loop on the path that has no bound, 0 if every loop is bounded
+  */
+  int unbounded = 0;
+};
+
+extern std::vector<Section> sections;
+
+/*
+Work out the longest path, in instructions, from every .mark point of each process to 
+the next .mark it can reach. A .mark applies to the instruction that follows it. Loops
+go round at most the number of times given by a .loopbound written in front of their 
+head, or the count loaded into the counter of a djnz loop that makes no calls. A call 
+costs the longest path through the subroutine up to its ret.
+
+The instructions in the listing are given the most clock cycles each one can take, 
+from the sequence RAM, and the first instruction of each basic block the cycles of the 
+whole block.
+
+This must be called after program::load() on the finished program.
+*/
+void analyse();
+
+/*
+Print the longest path from each .mark point to the screen
+*/
+void printReport();
+
+} // namespace wcet
+
+#endif
@@ -0,0 +1,335 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#include "inliner.hpp"
+#include "dataflow.hpp"
+#include "program.hpp"
+#include "data.hpp"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <iostream>
+
+namespace inliner
+{
+
+/*
+  The most times a process is analysed while inlining, one call is changed each time
+  */
+const int MAX_PASSES = 256;
+
+/*
+  The text shown in the listing in front of an inlined instruction
+  */
+const std::string INLINED_MARKER = "<inlined> ";
+const std::string TAIL_CALL_MARKER = "<tail call> ";
+
+Report report;
+
+/*
+  Ids of the calls that were not inlined because the budget ran out
+  */
+static std::set<int> skipped;
+
+/*
+  Subroutine
+
+  A leaf subroutine that is placed in one piece from its entry to its last node
+  */
+class Subroutine
+{
+public:
+  int start = 0;
+  int end = 0;
+  int link = 0;
+};
+
+/*
+  Returns true if the node is a ret through the given register
+  */
+static bool isReturn(program::Node &n, int link)
+{
+    return program::isJALR(n.op) && n.rd == link && n.rs1 == link;
+}
+
+/*
+  Strip the leading white space from the listing text of a node
+  */
+static std::string trimmed(std::string s)
+{
+    std::size_t p = s.find_first_not_of(" \t");
+    return p == std::string::npos ? "" : s.substr(p);
+}
+
+/*
+  Find the extent of the subroutine that starts at position p and returns through the
+  register link. Returns false if it is not a leaf subroutine that can be copied.
+  */
+static bool subroutine(dataflow::Analysis &a, int p, int link, Subroutine &s)
+{
+    program::Code &c = a.code;
+    int count = c.nodes.size();
+    if (p < 0 || p >= count || a.foreign_read[link] || a.foreign_write[link])
+        return false;
+
+    std::vector<bool> in(count, false);
+    std::vector<int> work;
+    in[p] = true;
+    work.push_back(p);
+    int last = p;
+    while (!work.empty())
+    {
+        int k = work.back();
+        work.pop_back();
+        program::Node &n = c.nodes[k];
+        last = std::max(last, k);
+        if (isReturn(n, link))
+            continue;
+        if ((program::isJAL(n.op) && n.rd != 0) || a.unknown_exit[k])
+            return false;
+        if (a.uses(k, a.in[k])[link] || a.mayDefs(k, a.in[k])[link])
+            return false;
+        for (auto t = a.succ[k].begin(); t != a.succ[k].end(); ++t)
+        {
+            if (*t >= count || *t < p)
+                return false;
+            if (!in[*t])
+            {
+                in[*t] = true;
+                work.push_back(*t);
+            }
+        }
+    }
+    for (int k = p; k <= last; k++)
+    {
+        if (!in[k])
+            return false;
+    }
+
+    s.start = p;
+    s.end = last + 1;
+    s.link = link;
+    return true;
+}
+
+/*
+  The number of nodes a copy of the subroutine takes
+  */
+static int copySize(program::Code &c, Subroutine &s)
+{
+    // The ret at the end of the copy falls through instead
+    return s.end - s.start - (isReturn(c.nodes[s.end - 1], s.link) ? 1 : 0);
+}
+
+/*
+  Replace the call at position i with a copy of the subroutine
+  */
+static void inlineCall(program::Code &c, int i, Subroutine &s)
+{
+    program::Node call = c.nodes[i];
+    int after = i + 1 < (int)c.nodes.size() ? c.nodes[i + 1].id : c.end_id;
+    int size = copySize(c, s);
+
+    std::map<int, int> ids;
+    std::vector<program::Node> seq;
+    for (int k = s.start; k < s.start + size; k++)
+    {
+        program::Node n = c.nodes[k];
+        program::Node copy = program::makeNode(n.op, n.rd, n.rs1, n.rs2);
+        int id = copy.id;
+        copy = n;
+        copy.id = id;
+        copy.ins = -1;
+        copy.anchor = call.anchor;
+        copy.line_number = call.line_number;
+        copy.text = INLINED_MARKER + trimmed(n.text);
+        if (isReturn(n, s.link))
+        {
+            copy.op = INSTRUCTION_JAL_VALUE;
+            copy.rd = 0;
+            copy.rs1 = 0;
+            copy.rs2 = 0;
+            copy.target = after;
+        }
+        ids[n.id] = id;
+        seq.push_back(copy);
+    }
+    if (size < s.end - s.start)
+        ids[c.nodes[s.end - 1].id] = after;
+
+    for (auto n = seq.begin(); n != seq.end(); ++n)
+    {
+        if (n->target < 0 || n->target == after)
+            continue;
+        auto m = ids.find(program::resolve(n->target));
+        if (m != ids.end())
+            n->target = m->second;
+    }
+
+    c.nodes.erase(c.nodes.begin() + i);
+    program::redirect(call.id, seq.empty() ? after : seq[0].id);
+    c.nodes.insert(c.nodes.begin() + i, seq.begin(), seq.end());
+
+    report.inlined++;
+    report.added += size - 1;
+}
+
+/*
+  Returns true if the register is only used to hold return addresses, it is written by 
+  calls and read by rets and nothing else
+  */
+static bool linkOnly(dataflow::Analysis &a, int link)
+{
+    program::Code &c = a.code;
+    if (link == 0 || a.foreign_read[link] || a.foreign_write[link])
+        return false;
+    for (std::size_t k = 0; k < c.nodes.size(); k++)
+    {
+        program::Node &n = c.nodes[k];
+        if (isReturn(n, link) || (program::isJAL(n.op) && n.rd == link))
+            continue;
+        if (a.uses(k, a.in[k])[link] || a.mayDefs(k, a.in[k])[link])
+            return false;
+    }
+    return true;
+}
+
+/*
+  Returns true if any node of the program refers to the node with the given id
+  */
+static bool referenced(int id)
+{
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+    {
+        for (auto n = c->nodes.begin(); n != c->nodes.end(); ++n)
+        {
+            if (n->target >= 0 && program::resolve(n->target) == id)
+                return true;
+        }
+    }
+    return false;
+}
+
+/*
+  Turn the call at position i, which is followed by a ret through another register, 
+  into a move of the return address into the link register and a jump
+  */
+static bool tailCall(dataflow::Analysis &a, int i)
+{
+    program::Code &c = a.code;
+    if (i + 1 >= (int)c.nodes.size())
+        return false;
+    program::Node call = c.nodes[i];
+    program::Node ret = c.nodes[i + 1];
+    if (!program::isJALR(ret.op) || ret.rd != ret.rs1 || ret.rd == call.rd || ret.rd == 0)
+        return false;
+    if (!linkOnly(a, call.rd) || a.foreign_write[ret.rd])
+        return false;
+
+    program::Node move = program::makeNode(INSTRUCTION_ADD_VALUE, call.rd, ret.rd, 0);
+    move.anchor = call.anchor;
+    move.line_number = call.line_number;
+    move.text = TAIL_CALL_MARKER + trimmed(call.text);
+    program::Node jump = program::makeNode(INSTRUCTION_JAL_VALUE, 0, 0, 0);
+    jump.target = call.target;
+    jump.anchor = call.anchor;
+    jump.line_number = call.line_number;
+    jump.text = move.text;
+
+    c.nodes.erase(c.nodes.begin() + i);
+    program::redirect(call.id, move.id);
+    c.nodes.insert(c.nodes.begin() + i, jump);
+    c.nodes.insert(c.nodes.begin() + i, move);
+
+    // The ret is left in place if anything else still jumps to it
+    if (!referenced(ret.id))
+        program::removeNode(c, i + 2);
+
+    report.tail_calls++;
+    return true;
+}
+
+/*
+  Inline or turn into a jump one call of the process. Returns true if the code changed.
+  */
+static bool inlineOne(program::Code &c, int &size, int budget)
+{
+    dataflow::scan();
+    dataflow::Analysis a(c);
+    a.run();
+
+    int count = c.nodes.size();
+    for (int i = 0; i < count; i++)
+    {
+        program::Node &n = c.nodes[i];
+        if (!a.reachable[i] || !program::isJAL(n.op) || n.rd == 0)
+            continue;
+
+        int p = a.jumpTarget(i);
+        Subroutine s;
+        if (p >= 0 && subroutine(a, p, n.rd, s) && program::findHint(c, p, NOINLINE) < 0)
+        {
+            bool wanted = program::findHint(c, p, INLINE) >= 0 ||
+                          (data::options.inline_size > 0 && s.end - s.start <= data::options.inline_size);
+            // A register used for nothing but calls and rets does not need the return
+            // address once the call is gone, even where a ret makes everything live
+            bool live = i + 1 >= count || (a.live_in[i + 1][n.rd] && !linkOnly(a, n.rd));
+            int growth = copySize(c, s) - 1;
+            if (wanted && !live)
+            {
+                if (size + growth <= budget)
+                {
+                    inlineCall(c, i, s);
+                    size += growth;
+                    return true;
+                }
+                skipped.insert(n.id);
+            }
+        }
+        if (p >= 0 && tailCall(a, i))
+            return true;
+    }
+    return false;
+}
+
+void inlineCalls()
+{
+    int size = 0;
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+        size += c->nodes.size();
+    int budget = data::options.inline_budget > 0 ? data::options.inline_budget : data::options.imem_size;
+    budget = std::min(budget, data::options.imem_size);
+
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+    {
+        for (int pass = 0; pass < MAX_PASSES; pass++)
+        {
+            if (!inlineOne(*c, size, budget))
+                break;
+        }
+    }
+    report.skipped = skipped.size();
+}
+
+void printReport()
+{
+    std::cout << "inlined " << report.inlined << " calls, ";
+    std::cout << "tail calls " << report.tail_calls << ", ";
+    std::cout << "instructions added " << report.added << ", ";
+    std::cout << "not inlined " << report.skipped << std::endl;
+}
+
+} // namespace inliner
@@ -168,6 +168,13 @@ void getALUTarget(Symbol &sym, int &command)
 
 int getImmValue(void)
 {
+    bool address;
+    return getImmValue(address);
+}
+
+int getImmValue(bool &address)
+{
+    address = false;
     Token t = data::token_list.expect(data::state.error, {NUMBER, IDENTIFIER});
     if (data::state.error)
         return 0;
@@ -175,6 +182,12 @@ int getImmValue(void)
     int val = numutils::getIValue(t);
     if (data::state.error)
         return 0;
+
+    if (t.type == IDENTIFIER)
+    {
+        Symbol sym = data::symbol_list.getSymbolFromTable(data::state.error, t.s_value, data::state.in_process, data::state.process_name);
+        address = sym.type() == LABEL;
+    }
     return val;
 }
 
@@ -298,7 +311,8 @@ void createLDIInstruction(int command)
     if (!checkComma())
         return;
 
-    int imm = getImmValue();
+    bool address;
+    int imm = getImmValue(address);
     if (data::state.error)
         return;
 
@@ -310,7 +324,7 @@ void createLDIInstruction(int command)
     inst += stutils::int_to_hex((imm >> 8) & 0xff);
     inst += stutils::int_to_hex(imm & 0xff);
 
-    data::log(inst);
+    data::log(inst, address);
 }
 
 void createSRLInstruction(int command)
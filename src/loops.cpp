@@ -0,0 +1,771 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#include "loops.hpp"
+#include "program.hpp"
+#include "macro.hpp"
+#include "data.hpp"
+#include <algorithm>
+#include <set>
+#include <iostream>
+
+namespace loops
+{
+
+/*
+  The most times a process is analysed while hoisting
+  */
+const int MAX_PASSES = 32;
+
+/*
+  The text shown in the listing in front of a hoisted instruction
+  */
+const std::string HOISTED_MARKER = "<hoisted> ";
+const std::string UNROLLED_MARKER = "<unrolled> ";
+
+Report report;
+
+/*
+  Ids of the loop heads that have had something hoisted out of them
+  */
+static std::set<int> heads;
+
+/*
+  Predecessor positions of every node, only edges from reachable nodes are included
+  */
+static std::vector<std::vector<int>> predecessors(dataflow::Analysis &a)
+{
+    int count = a.code.nodes.size();
+    std::vector<std::vector<int>> pred(count);
+    for (int i = 0; i < count; i++)
+    {
+        if (!a.reachable[i])
+            continue;
+        for (auto s = a.succ[i].begin(); s != a.succ[i].end(); ++s)
+        {
+            if (*s < count)
+                pred[*s].push_back(i);
+        }
+    }
+    return pred;
+}
+
+std::vector<std::vector<bool>> dominators(dataflow::Analysis &a)
+{
+    int count = a.code.nodes.size();
+    std::vector<std::vector<int>> pred = predecessors(a);
+    std::vector<std::vector<bool>> dom(count, std::vector<bool>(count, true));
+
+    // The start of the process and anywhere that can be entered from an unknown
+    // place are only dominated by themselves
+    std::vector<bool> root(count, false);
+    for (int i = 0; i < count; i++)
+    {
+        root[i] = i == 0 || a.unknown_entry[i];
+        if (root[i] || !a.reachable[i])
+        {
+            dom[i].assign(count, false);
+            dom[i][i] = root[i];
+        }
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 0; i < count; i++)
+        {
+            if (root[i] || !a.reachable[i])
+                continue;
+            std::vector<bool> d(count, true);
+            for (auto p = pred[i].begin(); p != pred[i].end(); ++p)
+            {
+                for (int j = 0; j < count; j++)
+                    d[j] = d[j] && dom[*p][j];
+            }
+            d[i] = true;
+            if (d != dom[i])
+            {
+                dom[i] = d;
+                changed = true;
+            }
+        }
+    }
+    return dom;
+}
+
+std::vector<Loop> findLoops(dataflow::Analysis &a, std::vector<std::vector<bool>> &dom)
+{
+    int count = a.code.nodes.size();
+    std::vector<std::vector<int>> pred = predecessors(a);
+    std::vector<Loop> loops;
+
+    for (int t = 0; t < count; t++)
+    {
+        if (!a.reachable[t])
+            continue;
+        for (auto s = a.succ[t].begin(); s != a.succ[t].end(); ++s)
+        {
+            int h = *s;
+            if (h >= count || !dom[t][h])
+                continue;
+
+            Loop *l = 0;
+            for (auto it = loops.begin(); it != loops.end(); ++it)
+            {
+                if (it->head == h)
+                    l = &*it;
+            }
+            if (!l)
+            {
+                Loop n;
+                n.head = h;
+                n.body.assign(count, false);
+                n.body[h] = true;
+                loops.push_back(n);
+                l = &loops.back();
+            }
+            l->tails.push_back(t);
+
+            // Everything that can get to the tail without going through the head
+            std::vector<int> work(1, t);
+            while (!work.empty())
+            {
+                int i = work.back();
+                work.pop_back();
+                if (l->body[i])
+                    continue;
+                l->body[i] = true;
+                for (auto p = pred[i].begin(); p != pred[i].end(); ++p)
+                    work.push_back(*p);
+            }
+        }
+    }
+
+    for (auto l = loops.begin(); l != loops.end(); ++l)
+        l->size = std::count(l->body.begin(), l->body.end(), true);
+    std::sort(loops.begin(), loops.end(), [](const Loop &x, const Loop &y) { return x.size < y.size; });
+    return loops;
+}
+
+/*
+  Returns true if the node at position i writes a register that is still wanted when 
+  the loop is left before the node has been run.
+  */
+static bool neededOnExit(dataflow::Analysis &a, Loop &l, std::vector<std::vector<bool>> &dom, int i, int reg)
+{
+    int count = a.code.nodes.size();
+    for (int x = 0; x < count; x++)
+    {
+        if (!l.body[x] || dom[x][i])
+            continue;
+        if (a.unknown_exit[x])
+            return true;
+        for (auto s = a.succ[x].begin(); s != a.succ[x].end(); ++s)
+        {
+            if (*s >= count || (!l.body[*s] && a.live_in[*s][reg]))
+                return true;
+        }
+    }
+    return false;
+}
+
+/*
+  Returns true if the value the node at position i writes is the same every time
+  round the loop and it is safe to write it once in front of the loop instead.
+
+  dataflow::Registers &written  - every register that the loop may write, other than
+                                  by the node itself
+  */
+static bool invariant(dataflow::Analysis &a, Loop &l, std::vector<std::vector<bool>> &dom, int i, dataflow::Registers &written)
+{
+    program::Node &n = a.code.nodes[i];
+    dataflow::Values &v = a.in[i];
+
+    if ((!program::isLDI(n.op) && !program::isALU(n.op)) || n.table)
+        return false;
+    if ((n.op & (OPCODE_RD_INDIRECT | OPCODE_RS2_INDIRECT)) || !a.sideEffectFree(i, v))
+        return false;
+    if (n.rd == 0 || a.foreign_read[n.rd] || a.foreign_write[n.rd])
+        return false;
+
+    dataflow::Registers used = a.uses(i, v);
+    if (used[n.rd] || (used & written).any() || written[n.rd])
+        return false;
+    if (a.live_in[l.head][n.rd])
+        return false;
+    return !neededOnExit(a, l, dom, i, n.rd);
+}
+
+/*
+  Every register that the nodes of the loop, other than the one at position skip, may write
+  */
+static dataflow::Registers loopWrites(dataflow::Analysis &a, Loop &l, int skip)
+{
+    dataflow::Registers r;
+    for (std::size_t j = 0; j < l.body.size(); j++)
+    {
+        if (l.body[j] && (int)j != skip)
+            r |= a.mayDefs(j, a.in[j]);
+    }
+    return r;
+}
+
+/*
+  If the node at position i is a label load that only feeds the register jump after it, 
+  and the register is also written elsewhere in the loop, move the pair onto a register 
+  of their own. Returns true if that was done.
+
+  dataflow::Registers &written  - every register the loop may write, other than by the node
+  */
+static bool rename(dataflow::Analysis &a, Loop &l, int i, std::vector<std::vector<int>> &pred, dataflow::Registers &written, int &temps)
+{
+    program::Code &c = a.code;
+    int count = c.nodes.size();
+    if (i + 1 >= count || !l.body[i + 1])
+        return false;
+
+    program::Node &n = c.nodes[i];
+    program::Node &j = c.nodes[i + 1];
+    if (!program::isLDI(n.op) || !n.address || !program::isRegisterJump(j.op) || j.rd != n.rd)
+        return false;
+    if (a.foreign_read[n.rd] || a.foreign_write[n.rd] || a.live_out[i + 1][n.rd])
+        return false;
+    if (pred[i + 1].size() != 1 || a.unknown_entry[i + 1])
+        return false;
+    if (j.rs1 == n.rd || j.rs2 == n.rd || (program::isJALR(j.op) && j.rs1 == n.rd))
+        return false;
+    if (!written[n.rd] || data::state.register_count >= dataflow::REGISTER_COUNT)
+        return false;
+
+    // If the loop writes through a pointer that could point anywhere a new register 
+    // would not be any safer
+    if (written.count() >= dataflow::REGISTER_COUNT - 2)
+        return false;
+
+    Symbol sym;
+    std::string name = data::state.process_name;
+    data::state.process_name = c.name;
+    std::size_t registers = data::data.reg_list.size();
+    instructions::getMacroRegister(sym, "L" + std::to_string(temps++));
+    data::state.process_name = name;
+    if (data::data.reg_list.size() > registers)
+        data::data.reg_process.back() = c.process;
+    if (data::state.error)
+        return false;
+
+    n.rd = sym.location();
+    j.rd = sym.location();
+    report.renamed++;
+    return true;
+}
+
+/*
+  Hoist what can be hoisted out of one loop. Returns true if anything was changed.
+  */
+static bool hoistLoop(dataflow::Analysis &a, Loop &l, std::vector<std::vector<bool>> &dom, int &temps)
+{
+    program::Code &c = a.code;
+    int count = c.nodes.size();
+    int h = l.head;
+
+    // Anything coming in from an unknown place would miss the preheader, and a loop 
+    // that falls into its own head has nowhere to put one.
+    if (a.unknown_entry[h] || c.nodes[h].table)
+        return false;
+    if (h > 0 && l.body[h - 1] && std::find(a.succ[h - 1].begin(), a.succ[h - 1].end(), h) != a.succ[h - 1].end())
+        return false;
+
+    std::vector<std::vector<int>> pred = predecessors(a);
+    std::vector<int> moves;
+    bool renamed = false;
+    for (int i = 0; i < count; i++)
+    {
+        if (!l.body[i])
+            continue;
+        dataflow::Registers written = loopWrites(a, l, i);
+        if (invariant(a, l, dom, i, written))
+            moves.push_back(i);
+        else if (rename(a, l, i, pred, written, temps))
+            renamed = true;
+    }
+    if (moves.empty())
+        return renamed;
+
+    // Outside jumps to the head now go to the preheader
+    int head_id = c.nodes[h].id;
+    program::Node first = program::makeNode(0, 0, 0, 0);
+    for (int i = 0; i < count; i++)
+    {
+        program::Node &n = c.nodes[i];
+        if (!l.body[i] && n.target >= 0 && program::resolve(n.target) == head_id)
+            n.target = first.id;
+    }
+
+    std::vector<program::Node> hoisted;
+    for (auto m = moves.begin(); m != moves.end(); ++m)
+    {
+        program::Node &n = c.nodes[*m];
+        program::Node p = m == moves.begin() ? first : program::makeNode(0, 0, 0, 0);
+        int id = p.id;
+        p = n;
+        p.id = id;
+        p.ins = -1;
+        p.anchor = c.nodes[h].anchor;
+        p.text = HOISTED_MARKER + n.text.substr(std::min(n.text.find_first_not_of(" \t"), n.text.size()));
+        hoisted.push_back(p);
+    }
+    for (auto m = moves.rbegin(); m != moves.rend(); ++m)
+        program::removeNode(c, *m);
+
+    int at = c.indexOf(program::resolve(head_id));
+    for (auto p = hoisted.begin(); p != hoisted.end(); ++p)
+        program::insertNode(c, at++, *p);
+
+    heads.insert(program::resolve(head_id));
+    report.hoisted += moves.size();
+    report.loops = heads.size();
+    return true;
+}
+
+void hoist()
+{
+    heads.clear();
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+    {
+        int temps = 0;
+        for (int pass = 0; pass < MAX_PASSES; pass++)
+        {
+            dataflow::scan();
+            dataflow::Analysis a(*c);
+            a.run();
+            std::vector<std::vector<bool>> dom = dominators(a);
+            std::vector<Loop> found = findLoops(a, dom);
+
+            bool changed = false;
+            for (auto l = found.begin(); l != found.end() && !changed; ++l)
+                changed = hoistLoop(a, *l, dom, temps);
+            if (!changed)
+                break;
+        }
+    }
+}
+
+/*
+  Strip the leading white space from the listing text of a node
+  */
+static std::string trimmed(std::string s)
+{
+    std::size_t p = s.find_first_not_of(" \t");
+    return p == std::string::npos ? "" : s.substr(p);
+}
+
+/*
+  CountedLoop
+
+  A djnz loop whose body is in one piece, from the head down to the decrement and jump
+  at its end.
+  */
+class CountedLoop
+{
+public:
+    int head = 0;
+    int tail = 0;
+    int counter = 0;
+    int trips = 0;
+
+    /*
+    The body uses the counter, or leaves the loop somewhere the counter is wanted, so
+    every decrement has to be kept
+    */
+    bool reads_counter = false;
+
+    /*
+    The counter is wanted after the loop ends
+    */
+    bool counter_live = false;
+
+    /*
+    Number of nodes in the body, not counting the decrement and the jump
+    */
+    int body = 0;
+};
+
+/*
+  Returns true if the loop is a djnz loop with a known number of trips
+  */
+static bool countedLoop(dataflow::Analysis &a, Loop &l, CountedLoop &cl)
+{
+    program::Code &c = a.code;
+    int count = c.nodes.size();
+    int h = l.head;
+    if (l.tails.size() != 1 || h == 0 || a.unknown_entry[h])
+        return false;
+
+    int t = l.tails[0];
+    if (t < h + 1 || l.size != t - h + 1)
+        return false;
+
+    program::Node &j = c.nodes[t];
+    program::Node &d = c.nodes[t - 1];
+    int n = j.rd;
+    if (j.op != 0x95 || a.jumpTarget(t) != h || n == 0 || a.foreign_read[n] || a.foreign_write[n])
+        return false;
+    if (d.op != 0x00 || d.rd != n || !((d.rs1 == n && d.rs2 == 2) || (d.rs2 == n && d.rs1 == 2)) || a.in[t - 1][2] != 0xffff)
+        return false;
+
+    cl.head = h;
+    cl.tail = t;
+    cl.counter = n;
+    cl.body = t - 1 - h;
+    cl.reads_counter = false;
+
+    int tail_id = c.nodes[t].id;
+    for (int i = h; i < t - 1; i++)
+    {
+        program::Node &b = c.nodes[i];
+        if (!l.body[i] || a.unknown_exit[i] || a.mayDefs(i, a.in[i])[n])
+            return false;
+        if (b.target >= 0 && program::resolve(b.target) == tail_id)
+            return false;
+        if (a.uses(i, a.in[i])[n])
+            cl.reads_counter = true;
+        for (auto s = a.succ[i].begin(); s != a.succ[i].end(); ++s)
+        {
+            if (*s >= count || (!l.body[*s] && a.live_in[*s][n]))
+                cl.reads_counter = true;
+        }
+    }
+    cl.counter_live = t + 1 >= count || a.live_in[t + 1][n];
+
+    // The counter must hold the same value on every way into the loop
+    std::vector<std::vector<int>> pred = predecessors(a);
+    int trips = dataflow::VALUE_UNDEF;
+    for (auto p = pred[h].begin(); p != pred[h].end(); ++p)
+    {
+        if (l.body[*p])
+            continue;
+        dataflow::Values v = a.in[*p];
+        a.transfer(*p, v);
+        if (!dataflow::isConstant(v[n]) || (trips != dataflow::VALUE_UNDEF && trips != v[n]))
+            return false;
+        trips = v[n];
+    }
+    cl.trips = trips;
+    return trips >= 1;
+}
+
+int tripCount(dataflow::Analysis &a, Loop &l)
+{
+    CountedLoop cl;
+    if (!countedLoop(a, l, cl))
+        return 0;
+    return cl.trips;
+}
+
+/*
+  How many nodes the loop grows by when unrolled by a factor, 0 for fully
+  */
+static int growth(CountedLoop &cl, int factor)
+{
+    int each = cl.body + (cl.reads_counter ? 1 : 0);
+    int size;
+    if (factor == 0 || factor >= cl.trips)
+    {
+        size = cl.trips * each + ((!cl.reads_counter && cl.counter_live) ? 1 : 0);
+    }
+    else
+    {
+        int left = cl.trips % factor;
+        size = left * each + factor * each + 1;
+        if (!cl.reads_counter)
+            size += 2;
+    }
+    return size - (cl.body + 2);
+}
+
+/*
+  Builds the nodes that replace an unrolled loop. A jump that went to the decrement at 
+  the end of the body goes to whatever follows the copy of the body.
+  */
+class Unroller
+{
+public:
+    Unroller(program::Code &c, CountedLoop &cl) : c(c), cl(cl) {}
+
+    std::vector<program::Node> seq;
+
+    /*
+    Add a node to the end of the new code
+    */
+    void push(program::Node n)
+    {
+        for (auto p = pending.begin(); p != pending.end(); ++p)
+            seq[*p].target = n.id;
+        pending.clear();
+        seq.push_back(n);
+    }
+
+    /*
+    Add a copy of the body of the loop, followed by the decrement when it is needed
+    */
+    void copyBody(int iteration, bool decrement)
+    {
+        std::map<int, int> ids;
+        int start = seq.size();
+        for (int i = cl.head; i < cl.tail - 1; i++)
+        {
+            program::Node n = copyOf(i, iteration);
+            ids[c.nodes[i].id] = n.id;
+            seq.push_back(n);
+        }
+
+        int dec_id = c.nodes[cl.tail - 1].id;
+        std::vector<int> ends;
+        for (std::size_t i = start; i < seq.size(); i++)
+        {
+            if (seq[i].target < 0)
+                continue;
+            int r = program::resolve(seq[i].target);
+            auto m = ids.find(r);
+            if (m != ids.end())
+                seq[i].target = m->second;
+            else if (r == dec_id)
+                ends.push_back(i);
+        }
+
+        // Anything left waiting for the next node is waiting for the start of this copy
+        if (start < (int)seq.size())
+        {
+            for (auto p = pending.begin(); p != pending.end(); ++p)
+                seq[*p].target = seq[start].id;
+            pending.clear();
+        }
+        pending.insert(pending.end(), ends.begin(), ends.end());
+
+        if (decrement)
+            push(copyOf(cl.tail - 1, iteration));
+    }
+
+    /*
+    Make a copy of the node at position i for the listing of the given iteration
+    */
+    program::Node copyOf(int i, int iteration)
+    {
+        program::Node n = c.nodes[i];
+        program::Node p = program::makeNode(n.op, n.rd, n.rs1, n.rs2);
+        int id = p.id;
+        p = n;
+        p.id = id;
+        p.ins = -1;
+        p.anchor = c.nodes[cl.head].anchor;
+        p.text = UNROLLED_MARKER + std::to_string(iteration) + " " + trimmed(n.text);
+        return p;
+    }
+
+    /*
+    Send anything still waiting for the next node to the node with the given id
+    */
+    void finish(int id)
+    {
+        for (auto p = pending.begin(); p != pending.end(); ++p)
+            seq[*p].target = id;
+        pending.clear();
+    }
+
+private:
+    program::Code &c;
+    CountedLoop &cl;
+    std::vector<int> pending;
+};
+
+/*
+  Replace the loop with the unrolled code. A factor of 0 unrolls it fully.
+  Returns the id of the jump at the end of the new loop, or -1 if there is no loop left.
+  */
+static int unrollLoop(program::Code &c, CountedLoop &cl, int factor)
+{
+    Unroller u(c, cl);
+    program::Node &dec = c.nodes[cl.tail - 1];
+    program::Node &jnz = c.nodes[cl.tail];
+    int loop_id = -1;
+
+    if (factor == 0 || factor >= cl.trips)
+    {
+        for (int i = 0; i < cl.trips; i++)
+            u.copyBody(i + 1, cl.reads_counter);
+        if (!cl.reads_counter && cl.counter_live)
+        {
+            program::Node n = program::makeNode(INSTRUCTION_LDI_VALUE, cl.counter, 0, 0);
+            n.anchor = c.nodes[cl.head].anchor;
+            n.line_number = dec.line_number;
+            n.text = UNROLLED_MARKER + trimmed(dec.text);
+            u.push(n);
+        }
+    }
+    else
+    {
+        int left = cl.trips % factor;
+        int iteration = 1;
+        for (int i = 0; i < left; i++)
+            u.copyBody(iteration++, cl.reads_counter);
+        if (!cl.reads_counter)
+        {
+            program::Node n = program::makeNode(INSTRUCTION_LDI_VALUE, cl.counter, 0, 0);
+            n.setImm(cl.trips / factor);
+            n.anchor = c.nodes[cl.head].anchor;
+            n.line_number = dec.line_number;
+            n.text = UNROLLED_MARKER + trimmed(dec.text);
+            u.push(n);
+        }
+        std::size_t block = u.seq.size();
+        for (int i = 0; i < factor; i++)
+            u.copyBody(iteration++, cl.reads_counter || i == factor - 1);
+        program::Node j = u.copyOf(cl.tail, iteration - 1);
+        j.target = u.seq[block].id;
+        u.push(j);
+        loop_id = j.id;
+    }
+
+    int after = cl.tail + 1 < (int)c.nodes.size() ? c.nodes[cl.tail + 1].id : c.end_id;
+    u.finish(after);
+
+    // Whatever referred to the old loop now refers to the start of the new code
+    int first = u.seq.empty() ? after : u.seq[0].id;
+    std::vector<int> old;
+    for (int i = cl.head; i <= cl.tail; i++)
+        old.push_back(c.nodes[i].id);
+    c.nodes.erase(c.nodes.begin() + cl.head, c.nodes.begin() + cl.tail + 1);
+    for (auto id = old.begin(); id != old.end(); ++id)
+        program::redirect(*id, *id == jnz.id ? after : first);
+    c.nodes.insert(c.nodes.begin() + cl.head, u.seq.begin(), u.seq.end());
+
+    report.unrolled++;
+    return loop_id;
+}
+
+/*
+  Unroll the loops of one process. The first time round only the loops with a hint are 
+  unrolled, so they get the room they asked for before the budget is shared out.
+  */
+static void unrollProcess(program::Code &c, bool automatic, int &size, std::vector<bool> &used, std::set<int> &done)
+{
+    for (int pass = 0; pass < MAX_PASSES; pass++)
+    {
+        dataflow::scan();
+        dataflow::Analysis a(c);
+        a.run();
+        std::vector<std::vector<bool>> dom = dominators(a);
+        std::vector<Loop> found = findLoops(a, dom);
+
+        bool changed = false;
+        for (auto l = found.begin(); l != found.end() && !changed; ++l)
+        {
+            if (l->tails.size() == 1 && done.count(c.nodes[l->tails[0]].id))
+                continue;
+            int hint = program::findHint(c, l->head, UNROLL);
+            if (hint >= 0 && used[hint])
+                hint = -1;
+            CountedLoop cl;
+            if (!countedLoop(a, *l, cl))
+            {
+                if (hint >= 0)
+                {
+                    used[hint] = true;
+                    report.skipped++;
+                }
+                continue;
+            }
+
+            int factor = -1;
+            if (hint >= 0)
+            {
+                used[hint] = true;
+                int f = data::data.hints[hint].value;
+                if (f == 1)
+                    continue;
+                if (size + growth(cl, f) <= data::options.imem_size)
+                    factor = f;
+                else
+                    report.skipped++;
+            }
+            else if (automatic && data::options.unroll_budget > 0)
+            {
+                int budget = std::min(data::options.unroll_budget, data::options.imem_size);
+                for (int f = cl.trips; f >= 2 && factor < 0; f--)
+                {
+                    if (size + growth(cl, f == cl.trips ? 0 : f) <= budget)
+                        factor = f == cl.trips ? 0 : f;
+                }
+            }
+            if (factor < 0)
+                continue;
+
+            int g = growth(cl, factor);
+            int loop_id = unrollLoop(c, cl, factor);
+            if (loop_id >= 0)
+                done.insert(loop_id);
+            size += g;
+            report.added += g;
+            changed = true;
+        }
+        if (!changed)
+            break;
+    }
+}
+
+void unroll()
+{
+    int size = 0;
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+        size += c->nodes.size();
+
+    std::vector<bool> used(data::data.hints.size(), false);
+    std::set<int> done;
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+        unrollProcess(*c, false, size, used, done);
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+        unrollProcess(*c, true, size, used, done);
+
+    for (std::size_t h = 0; h < used.size(); h++)
+    {
+        if (!used[h] && data::data.hints[h].name == UNROLL)
+        {
+            report.ignored.push_back(data::data.hints[h].line_number);
+            report.skipped++;
+        }
+    }
+}
+
+void printReport()
+{
+    if (data::options.hoist)
+    {
+        std::cout << "hoisted " << report.hoisted << " instructions, ";
+        std::cout << "loops " << report.loops << ", ";
+        std::cout << "registers added " << report.renamed << std::endl;
+    }
+    if (data::options.unroll_budget > 0 || program::hasHint(UNROLL))
+    {
+        std::cout << "unrolled " << report.unrolled << " loops, ";
+        std::cout << "instructions added " << report.added << ", ";
+        std::cout << "not unrolled " << report.skipped << std::endl;
+        for (auto l = report.ignored.begin(); l != report.ignored.end(); ++l)
+            std::cout << "warning: " << UNROLL << " on line " << *l << " was not used, no loop was found after it" << std::endl;
+    }
+}
+
+} // namespace loops
@@ -17,6 +17,8 @@
 #include "macro.hpp"
 #include "data.hpp"
 #include "string_utils.hpp"
+#include "num_utils.hpp"
+#include <vector>
 
 namespace instructions
 {
@@ -41,6 +43,18 @@ const int MACRO_JLT_LENGTH = 2;
 const int MACRO_ST_LENGTH = 1;
 const int MACRO_LD_LENGTH = 1;
 const int MACRO_MOV_LENGTH = 1;
+const int MACRO_SWITCH_LENGTH = 6; // Not counting the table
+const int MACRO_SETF_LENGTH = 1;
+const int MACRO_CLRF_LENGTH = 1;
+const int MACRO_JFS_LENGTH = 2;
+const int MACRO_JFC_LENGTH = 2;
+
+/*
+  The length of a mul, div or mod depends on its operands so is worked out below
+  */
+static int getLengthOfArithmetic(std::string m);
+static int getLengthOfBlock(std::string m);
+static int getLengthOfSwitch(void);
 
 int getLengthOfMacro(std::string m)
 {
@@ -86,6 +100,20 @@ int getLengthOfMacro(std::string m)
         return MACRO_ST_LENGTH;
     else if (m == MACRO_MOV)
         return MACRO_MOV_LENGTH;
+    else if (m == MACRO_MUL || m == MACRO_DIV || m == MACRO_MOD)
+        return getLengthOfArithmetic(m);
+    else if (m == MACRO_MEMCPY || m == MACRO_MEMSET)
+        return getLengthOfBlock(m);
+    else if (m == MACRO_SWITCH)
+        return getLengthOfSwitch();
+    else if (m == MACRO_SETF)
+        return MACRO_SETF_LENGTH;
+    else if (m == MACRO_CLRF)
+        return MACRO_CLRF_LENGTH;
+    else if (m == MACRO_JFS)
+        return MACRO_JFS_LENGTH;
+    else if (m == MACRO_JFC)
+        return MACRO_JFC_LENGTH;
     return 0; // Not a macro so no length
 }
 
@@ -118,7 +146,7 @@ void getMacroRegister(Symbol &sym, std::string suffix)
     {
         Symbol s(REGISTER, 0, 1, data::state.register_count++);
         data::symbol_list.addSymbol(data_reg_name, s);
-        data::data.reg_list.push_back("0000"); // The register has a value of 0
+        data::data.addRegister("0000", data::data.pc_list.size() - 1); // The register has a value of 0
         try
         {
             sym = data::symbol_list.getSymbol(data_reg_name);
@@ -173,6 +201,420 @@ int getMacroImmValue(void)
     }
 }
 
+/*
+  The registers used by the steps of the macros that are planned before they are 
+  made (mul, div, mod, memcpy and memset). They are turned into register locations 
+  when the instructions are made.
+  */
+enum MacroRegister
+{
+    MR_ZERO,
+    MR_ONE,
+    MR_MINUS_ONE,
+    MR_DEST,
+    MR_SRC,
+    MR_TEMP1,
+    MR_TEMP2,
+    MR_TEMP3
+};
+
+/*
+  MacroStep
+
+  One instruction of a planned macro. For ldi, jz and jnz the immediate is either a 
+  value, or when address is set the offset of an instruction from the start of the macro.
+  */
+class MacroStep
+{
+public:
+    int op;
+    int rd;
+    int rs1;
+    int rs2;
+    int imm;
+    bool address;
+
+    /*
+    rs1 holds a bit number rather than a register, as it does for setb, jbsr and jbcr
+    */
+    bool bit;
+};
+
+static MacroStep step(int op, int rd, int rs1, int rs2)
+{
+    return MacroStep{op, rd, rs1, rs2, 0, false, false};
+}
+
+static MacroStep bitStep(int op, int rd, int bit, int rs2)
+{
+    return MacroStep{op, rd, bit, rs2, 0, false, true};
+}
+
+static MacroStep ldi(int rd, int imm, bool address = false)
+{
+    return MacroStep{INSTRUCTION_LDI_VALUE, rd, MR_ZERO, MR_ZERO, imm & 0xffff, address, false};
+}
+
+/*
+  Returns the power of two n is, or -1 if it is not one
+  */
+static int powerOfTwo(int n)
+{
+    for (int k = 0; k < 16; k++)
+    {
+        if (n == (1 << k))
+            return k;
+    }
+    return -1;
+}
+
+/*
+  Multiply by n with doublings and adds, worked from the top bit down. The digits 
+  are either the plain binary of n or its non adjacent form, where a digit of -1 adds 
+  -src that is worked out once at the start. A large n may also be made by multiplying
+  by -n and negating the result. The shortest of these is used.
+
+  bool same      - the destination is also the source
+  */
+static std::vector<MacroStep> planMul(int n, bool same)
+{
+    std::vector<MacroStep> steps;
+    if (n == 0)
+    {
+        steps.push_back(step(INSTRUCTION_ADD_VALUE, MR_DEST, MR_ZERO, MR_ZERO));
+        return steps;
+    }
+    if (n == 1)
+    {
+        steps.push_back(step(INSTRUCTION_ADD_VALUE, MR_DEST, MR_SRC, MR_ZERO));
+        return steps;
+    }
+
+    std::vector<int> binary, naf;
+    for (int v = n; v; v >>= 1)
+        binary.push_back(v & 1);
+    for (int v = n; v;)
+    {
+        int d = 0;
+        if (v & 1)
+        {
+            d = 2 - (v & 3);
+            v -= d;
+        }
+        naf.push_back(d);
+        v >>= 1;
+    }
+
+    std::vector<std::vector<MacroStep>> plans;
+    std::vector<std::vector<int>> forms = {binary, naf};
+    for (auto f = forms.begin(); f != forms.end(); ++f)
+    {
+        std::vector<int> &d = *f;
+        bool adds = false, subtracts = false;
+        for (std::size_t i = 0; i + 1 < d.size(); i++)
+        {
+            adds |= d[i] == 1;
+            subtracts |= d[i] == -1;
+        }
+
+        std::vector<MacroStep> s;
+        // The source is still wanted after the destination is first written
+        int src = MR_SRC;
+        if (same && adds)
+        {
+            s.push_back(step(INSTRUCTION_ADD_VALUE, MR_TEMP1, MR_SRC, MR_ZERO));
+            src = MR_TEMP1;
+        }
+        if (subtracts)
+        {
+            s.push_back(step(INSTRUCTION_XOR_VALUE, MR_TEMP2, MR_MINUS_ONE, MR_SRC));
+            s.push_back(step(INSTRUCTION_ADD_VALUE, MR_TEMP2, MR_TEMP2, MR_ONE));
+        }
+        int acc = src;
+        for (int i = d.size() - 2; i >= 0; i--)
+        {
+            s.push_back(step(INSTRUCTION_ADD_VALUE, MR_DEST, acc, acc));
+            acc = MR_DEST;
+            if (d[i] == 1)
+                s.push_back(step(INSTRUCTION_ADD_VALUE, MR_DEST, MR_DEST, src));
+            else if (d[i] == -1)
+                s.push_back(step(INSTRUCTION_ADD_VALUE, MR_DEST, MR_DEST, MR_TEMP2));
+        }
+        plans.push_back(s);
+    }
+
+    if (n > 0x8000)
+    {
+        std::vector<MacroStep> s = planMul(0x10000 - n, same);
+        if (n == 0xffff)
+            s.back() = step(INSTRUCTION_XOR_VALUE, MR_DEST, MR_MINUS_ONE, MR_SRC);
+        else
+            s.push_back(step(INSTRUCTION_XOR_VALUE, MR_DEST, MR_MINUS_ONE, MR_DEST));
+        s.push_back(step(INSTRUCTION_ADD_VALUE, MR_DEST, MR_DEST, MR_ONE));
+        plans.push_back(s);
+    }
+
+    std::size_t best = 0;
+    for (std::size_t i = 1; i < plans.size(); i++)
+    {
+        if (plans[i].size() < plans[best].size())
+            best = i;
+    }
+    return plans[best];
+}
+
+/*
+  Divide by n, or take the remainder. A power of two is a run of shifts or a mask, 
+  anything else is a long division with one step for each bit the quotient can have. 
+  Each step takes n shifted into place from the remainder and keeps the result if it 
+  did not go negative. As the remainder is always less than twice the shifted n the 
+  sign bit of the result tells if it went negative, except when the shifted n is more
+  than 0x8000 where a remainder without its top bit set is too small as well.
+
+  bool same      - the destination is also the source
+  bool mod       - the remainder is wanted rather than the quotient
+  */
+static std::vector<MacroStep> planDiv(int n, bool same, bool mod)
+{
+    std::vector<MacroStep> steps;
+    int k = powerOfTwo(n);
+    if (k == 0)
+    {
+        steps.push_back(mod ? step(INSTRUCTION_ADD_VALUE, MR_DEST, MR_ZERO, MR_ZERO)
+                            : step(INSTRUCTION_ADD_VALUE, MR_DEST, MR_SRC, MR_ZERO));
+        return steps;
+    }
+    if (k > 0 && mod)
+    {
+        steps.push_back(ldi(MR_TEMP1, n - 1));
+        steps.push_back(step(INSTRUCTION_AND_VALUE, MR_DEST, MR_SRC, MR_TEMP1));
+        return steps;
+    }
+    if (k > 0)
+    {
+        steps.push_back(step(INSTRUCTION_SRL_VALUE, MR_DEST, MR_SRC, MR_ZERO));
+        for (int i = 1; i < k; i++)
+            steps.push_back(step(INSTRUCTION_SRL_VALUE, MR_DEST, MR_DEST, MR_ZERO));
+        return steps;
+    }
+
+    int top = 0;
+    while ((n << (top + 1)) <= 0xffff)
+        top++;
+
+    // The remainder is worked on in the destination for mod and in a temp for div
+    int rem = mod ? MR_DEST : MR_TEMP1;
+    if (!mod || !same)
+        steps.push_back(step(INSTRUCTION_ADD_VALUE, rem, MR_SRC, MR_ZERO));
+    if (!mod)
+        steps.push_back(step(INSTRUCTION_ADD_VALUE, MR_DEST, MR_ZERO, MR_ZERO));
+
+    for (int j = top; j >= 0; j--)
+    {
+        int shifted = n << j;
+        bool last = j == 0;
+        // ldi and the jump, the load and add of -shifted, and what is kept
+        int length = 4 + (mod || !last ? 1 : 0) + (mod ? 0 : 1) + (shifted > 0x8000 ? 1 : 0);
+        int skip = steps.size() + length;
+        steps.push_back(ldi(MR_TEMP3, skip, true));
+        if (shifted > 0x8000)
+            steps.push_back(bitStep(INSTRUCTION_JBCR_VALUE, MR_TEMP3, 15, rem));
+        steps.push_back(ldi(MR_TEMP2, -shifted));
+        steps.push_back(step(INSTRUCTION_ADD_VALUE, MR_TEMP2, rem, MR_TEMP2));
+        steps.push_back(bitStep(INSTRUCTION_JBSR_VALUE, MR_TEMP3, 15, MR_TEMP2));
+        if (mod || !last)
+            steps.push_back(step(INSTRUCTION_ADD_VALUE, rem, MR_TEMP2, MR_ZERO));
+        if (!mod)
+            steps.push_back(bitStep(INSTRUCTION_SETB_VALUE, MR_DEST, j, MR_DEST));
+    }
+    return steps;
+}
+
+/*
+  Make the steps for a mul, div or mod
+  */
+static std::vector<MacroStep> planArithmetic(std::string m, int n, bool same)
+{
+    if (m == MACRO_MUL)
+        return planMul(n, same);
+    return planDiv(n, same, m == MACRO_MOD);
+}
+
+/*
+  Read the constant of a mul, div or mod and check that it is in range
+  */
+static int getArithmeticConstant(std::string m)
+{
+    int n = getMacroImmValue();
+    if (data::state.error)
+    {
+        data::setError(m + " needs a number or a constant that has already been defined");
+        return -1;
+    }
+    if (n < 0 || n > 0xffff || (n == 0 && m != MACRO_MUL))
+    {
+        data::setError(m + " constant out of range but is value -> " + std::to_string(n));
+        return -1;
+    }
+    return n;
+}
+
+/*
+  The length of a mul, div or mod depends on its constant and on whether the 
+  destination is also the source. The registers are compared by name because they 
+  may not have been declared yet.
+  */
+static int getLengthOfArithmetic(std::string m)
+{
+    if (!data::token_list.hasNext())
+        return 1;
+    Token dest = data::token_list.getNext();
+    if (!data::token_list.hasNext() || data::token_list.getNext().type != COMMA || !data::token_list.hasNext())
+        return 1;
+    Token src = data::token_list.getNext();
+    if (!data::token_list.hasNext() || data::token_list.getNext().type != COMMA)
+        return 1;
+    int n = getArithmeticConstant(m);
+    if (data::state.error)
+        return 0;
+    return planArithmetic(m, n, dest.s_value == src.s_value).size();
+}
+
+/*
+  Returns true if the next operand is a number or a constant rather than a register. 
+  The operand is left to be read.
+  */
+static bool isConstantOperand(void)
+{
+    if (!data::token_list.hasNext())
+        return false;
+    Token t = data::token_list.getNext();
+    data::token_list.goBack();
+    if (t.type == NUMBER)
+        return true;
+    int err = 0;
+    Symbol sym = data::symbol_list.getSymbolFromTable(err, t.s_value, data::state.in_process, data::state.process_name);
+    return !err && sym.type() == CONST;
+}
+
+/*
+  Copy or fill a block of n words of data RAM, k words to each time round the loop. 
+  Up to k words every word is written out. Otherwise the words left over from the loop
+  are written first and then a loop of k words is run by a djnz, even if it only goes 
+  round once. Both pointers are left just past the end of their block.
+
+  bool copy      - memcpy rather than memset
+  bool constant  - the value of a memset is a number that is loaded into a temp first
+  */
+static std::vector<MacroStep> planBlock(bool copy, int n, int k, bool constant, int value)
+{
+    std::vector<MacroStep> steps;
+    int src = MR_SRC;
+    if (!copy && constant)
+    {
+        steps.push_back(ldi(MR_TEMP2, value));
+        src = MR_TEMP2;
+    }
+
+    auto words = [&](int count) {
+        for (int i = 0; i < count; i++)
+        {
+            if (copy)
+            {
+                // mov (dest), (src) then step both pointers on
+                steps.push_back(step(0xc0, MR_DEST, MR_ZERO, src));
+                steps.push_back(step(INSTRUCTION_ADD_VALUE, MR_DEST, MR_ONE, MR_DEST));
+                steps.push_back(step(INSTRUCTION_ADD_VALUE, src, MR_ONE, src));
+            }
+            else
+            {
+                // mov (dest), value then step the pointer on
+                steps.push_back(step(0x80, MR_DEST, MR_ZERO, src));
+                steps.push_back(step(INSTRUCTION_ADD_VALUE, MR_DEST, MR_ONE, MR_DEST));
+            }
+        }
+    };
+
+    if (n <= k)
+    {
+        words(n);
+        return steps;
+    }
+
+    words(n % k);
+    steps.push_back(ldi(MR_TEMP1, n / k));
+    int loop = steps.size();
+    words(k);
+    steps.push_back(step(INSTRUCTION_ADD_VALUE, MR_TEMP1, MR_TEMP1, MR_MINUS_ONE));
+    MacroStep jnz = ldi(MR_TEMP1, loop, true);
+    jnz.op = INSTRUCTION_JNZ_VALUE;
+    steps.push_back(jnz);
+    return steps;
+}
+
+/*
+  Read the count and the optional unroll factor of a memcpy or memset
+  */
+static void getBlockCounts(std::string m, int &n, int &k)
+{
+    n = getMacroImmValue();
+    if (data::state.error || n < 1 || n > 0xffff)
+    {
+        data::setError(m + " needs a count from 1 to 65535 that is a number or a constant that has already been defined");
+        return;
+    }
+    k = data::options.block_unroll;
+    if (data::token_list.hasNext())
+    {
+        if (!checkComma())
+            return;
+        k = getMacroImmValue();
+        if (data::state.error || k < 1)
+        {
+            data::setError(m + " unroll factor must be 1 or more");
+            return;
+        }
+    }
+    if (k < 1)
+        k = 1;
+}
+
+/*
+  The length of a memcpy or memset depends on its count and unroll factor, and for 
+  memset on whether the value is a register
+  */
+static int getLengthOfBlock(std::string m)
+{
+    if (!data::token_list.hasNext())
+        return 1;
+    data::token_list.getNext();
+    if (!data::token_list.hasNext() || data::token_list.getNext().type != COMMA || !data::token_list.hasNext())
+        return 1;
+    bool constant = isConstantOperand();
+    data::token_list.getNext();
+    if (!data::token_list.hasNext() || data::token_list.getNext().type != COMMA)
+        return 1;
+    int n, k;
+    getBlockCounts(m, n, k);
+    if (data::state.error)
+        return 0;
+    return planBlock(m == MACRO_MEMCPY, n, k, constant && m == MACRO_MEMSET, 0).size();
+}
+
+/*
+  A switch is its dispatch followed by one table entry for each label
+  */
+static int getLengthOfSwitch(void)
+{
+    int labels = 0;
+    while (data::token_list.hasNext())
+    {
+        if (data::token_list.getNext().type == COMMA)
+            labels++;
+    }
+    return MACRO_SWITCH_LENGTH + labels;
+}
+
 void macroCall(void)
 {
     Symbol lab, reg;
@@ -194,8 +636,7 @@ void macroCall(void)
     jmp += stutils::int_to_hex(reg.location());
     jmp += stutils::int_to_hex((lab.location() >> 8) & 0xff);
     jmp += stutils::int_to_hex(lab.location() & 0xff);
-    data::data.ins_list.push_back(jmp);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, jmp, data::state.line);
+    data::logMacro(jmp, data::state.line);
 }
 
 void macroDec()
@@ -221,8 +662,7 @@ void macroDec()
     inst +=  "02";
     inst +=  stutils::int_to_hex(dest.location());
 
-    data::data.ins_list.push_back(inst);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, inst, data::state.line);
+    data::logMacro(inst, data::state.line);
 
 }
 
@@ -254,10 +694,8 @@ void macroDjnz(void)
     jnz += stutils::int_to_hex((lab.location() >> 8) & 0xff);
     jnz += stutils::int_to_hex(lab.location() & 0xff);
 
-    data::data.ins_list.push_back(add1);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, add1, data::state.line);
-    data::data.ins_list.push_back(jnz);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, jnz, COMMAND_EXPANDER);
+    data::logMacro(add1, data::state.line);
+    data::logMacro(jnz, COMMAND_EXPANDER);
 }
 
 void macroInc()
@@ -283,8 +721,7 @@ void macroInc()
     inst +=  "01";
     inst +=  stutils::int_to_hex(dest.location());
 
-    data::data.ins_list.push_back(inst);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, inst, data::state.line);
+    data::logMacro(inst, data::state.line);
 
 }
 
@@ -332,10 +769,8 @@ void macroJbs(int command)
     inst2 += stutils::int_to_hex(imm);
     inst2 += stutils::int_to_hex(rs1.location());
 
-    data::data.ins_list.push_back(inst1);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, inst1, data::state.line);
-    data::data.ins_list.push_back(inst2);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, inst2, COMMAND_EXPANDER);
+    data::logMacro(inst1, data::state.line, true);
+    data::logMacro(inst2, COMMAND_EXPANDER);
 }
 
 void macroJeq(int command)
@@ -370,10 +805,8 @@ void macroJeq(int command)
     inst2 += stutils::int_to_hex(rs1.location());
     inst2 += stutils::int_to_hex(rs2.location());
 
-    data::data.ins_list.push_back(inst1);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, inst1, data::state.line);
-    data::data.ins_list.push_back(inst2);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, inst2, COMMAND_EXPANDER);
+    data::logMacro(inst1, data::state.line, true);
+    data::logMacro(inst2, COMMAND_EXPANDER);
 }
 
 void macroJgtr(void)
@@ -407,8 +840,7 @@ void macroJgtr(void)
     inst += stutils::int_to_hex(rs2.location());
     inst += stutils::int_to_hex(rs1.location());
 
-    data::data.ins_list.push_back(inst);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, inst, data::state.line);
+    data::logMacro(inst, data::state.line);
 }
 
 void macroJle(int command)
@@ -443,10 +875,8 @@ void macroJle(int command)
     inst2 += stutils::int_to_hex(rs2.location());
     inst2 += stutils::int_to_hex(rs1.location());
 
-    data::data.ins_list.push_back(inst1);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, inst1, data::state.line);
-    data::data.ins_list.push_back(inst2);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, inst2, COMMAND_EXPANDER);
+    data::logMacro(inst1, data::state.line, true);
+    data::logMacro(inst2, COMMAND_EXPANDER);
 }
 
 void macroJler()
@@ -480,8 +910,7 @@ void macroJler()
     inst += stutils::int_to_hex(rs2.location());
     inst += stutils::int_to_hex(rs1.location());
 
-    data::data.ins_list.push_back(inst);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, inst, data::state.line);
+    data::logMacro(inst, data::state.line);
 }
 
 void macroJmp(void)
@@ -500,8 +929,7 @@ void macroJmp(void)
     jmp += "00"; // 0 in memory
     jmp += stutils::int_to_hex((lab.location() >> 8) & 0xff);
     jmp += stutils::int_to_hex(lab.location() & 0xff);
-    data::data.ins_list.push_back(jmp);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, jmp, data::state.line);
+    data::logMacro(jmp, data::state.line);
 }
 
 void macroSt(void)
@@ -529,8 +957,7 @@ void macroSt(void)
     cmd += "00";
     cmd += stutils::int_to_hex(reg.location());
 
-    data::data.ins_list.push_back(cmd);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, cmd, data::state.line);
+    data::logMacro(cmd, data::state.line);
 }
 
 void macroLd(void)
@@ -559,8 +986,7 @@ void macroLd(void)
     cmd += "00";
     cmd += stutils::int_to_hex(reg.location());
 
-    data::data.ins_list.push_back(cmd);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, cmd, data::state.line);
+    data::logMacro(cmd, data::state.line);
 }
 
 void macroMov(void)
@@ -583,8 +1009,7 @@ void macroMov(void)
     cmd += "00";
     cmd += stutils::int_to_hex(reg.location());
 
-    data::data.ins_list.push_back(cmd);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, cmd, data::state.line);
+    data::logMacro(cmd, data::state.line);
 }
 
 void macroRet(void)
@@ -603,8 +1028,7 @@ void macroRet(void)
     r += stutils::int_to_hex(reg.location());
     r += "00";
 
-    data::data.ins_list.push_back(r);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, r, data::state.line);
+    data::logMacro(r, data::state.line);
 }
 
 void macroSll(void)
@@ -633,11 +1057,199 @@ void macroSll(void)
     r += stutils::int_to_hex(rs1.location());
     r += stutils::int_to_hex(rs1.location());
 
-    data::data.ins_list.push_back(r);
-    data::data.insertLog(data::state.line_number,data::state.prog_count++, r, data::state.line);
+    data::logMacro(r, data::state.line);
 
 }
 
+/*
+  Make the instructions for the steps of a planned macro and log them
+  */
+static void emitSteps(std::vector<MacroStep> &steps, int dest, int src)
+{
+    // Only the temp registers that are used are made
+    int regs[] = {0, 1, 2, dest, src, 0, 0, 0};
+    for (auto s = steps.begin(); s != steps.end(); ++s)
+    {
+        for (int r : {s->rd, s->bit ? MR_ZERO : s->rs1, s->rs2})
+        {
+            if (r >= MR_TEMP1 && !regs[r])
+            {
+                Symbol temp;
+                getMacroRegister(temp, std::to_string(r - MR_TEMP1 + 1));
+                if (data::state.error)
+                    return;
+                regs[r] = temp.location();
+            }
+        }
+    }
+
+    int start = data::state.prog_count;
+    for (std::size_t i = 0; i < steps.size(); i++)
+    {
+        MacroStep &s = steps[i];
+        std::string inst = stutils::int_to_hex(s.op);
+        inst += stutils::int_to_hex(regs[s.rd]);
+        if (s.op == INSTRUCTION_LDI_VALUE || s.op == INSTRUCTION_JZ_VALUE || s.op == INSTRUCTION_JNZ_VALUE)
+        {
+            int imm = s.address ? start + s.imm : s.imm;
+            inst += stutils::int_to_hex((imm >> 8) & 0xff);
+            inst += stutils::int_to_hex(imm & 0xff);
+        }
+        else
+        {
+            inst += stutils::int_to_hex(s.bit ? s.rs1 : regs[s.rs1]);
+            inst += stutils::int_to_hex(regs[s.rs2]);
+        }
+        data::logMacro(inst, i == 0 ? data::state.line : COMMAND_EXPANDER, s.address && s.op == INSTRUCTION_LDI_VALUE);
+    }
+}
+
+void macroArithmetic(std::string m)
+{
+    Symbol dest, src;
+    getReg(dest);
+    if (data::state.error)
+        return;
+
+    if (!checkComma())
+        return;
+
+    getReg(src);
+    if (data::state.error)
+        return;
+
+    if (!checkComma())
+        return;
+
+    int n = getArithmeticConstant(m);
+    if (data::state.error)
+        return;
+
+    if (!checkForMore())
+        return;
+
+    std::vector<MacroStep> steps = planArithmetic(m, n, dest.location() == src.location());
+
+    emitSteps(steps, dest.location(), src.location());
+}
+
+void macroBlock(std::string m)
+{
+    Symbol dest, src;
+    getReg(dest);
+    if (data::state.error)
+        return;
+
+    if (!checkComma())
+        return;
+
+    bool constant = m == MACRO_MEMSET && isConstantOperand();
+    int value = 0;
+    if (constant)
+        value = getMacroImmValue();
+    else
+        getReg(src);
+    if (data::state.error)
+        return;
+
+    if (!checkComma())
+        return;
+
+    int n, k;
+    getBlockCounts(m, n, k);
+    if (data::state.error)
+        return;
+
+    if (!checkForMore())
+        return;
+
+    std::vector<MacroStep> steps = planBlock(m == MACRO_MEMCPY, n, k, constant, value);
+    emitSteps(steps, dest.location(), src.location());
+}
+
+void macroSwitch(void)
+{
+    Symbol index, limit, jump;
+    getMacroRegister(jump, "1");
+    if (data::state.error)
+        return;
+    getMacroRegister(limit, "2");
+    if (data::state.error)
+        return;
+
+    getReg(index);
+    if (data::state.error)
+        return;
+
+    std::vector<Symbol> labels;
+    while (data::token_list.hasNext())
+    {
+        if (!checkComma())
+            return;
+        Symbol lab;
+        getLabel(lab);
+        if (data::state.error)
+            return;
+        labels.push_back(lab);
+    }
+    if (labels.empty())
+    {
+        data::setError("switch needs at least one label");
+        return;
+    }
+
+    int table = data::state.prog_count + MACRO_SWITCH_LENGTH;
+    int end = table + labels.size();
+
+    // An index past the end of the table carries on after it
+    std::string inst1 = stutils::int_to_hex(INSTRUCTION_LDI_VALUE);
+    inst1 += stutils::int_to_hex(limit.location());
+    inst1 += stutils::int_to_hex((labels.size() >> 8) & 0xff);
+    inst1 += stutils::int_to_hex(labels.size() & 0xff);
+
+    std::string inst2 = stutils::int_to_hex(INSTRUCTION_LDI_VALUE);
+    inst2 += stutils::int_to_hex(jump.location());
+    inst2 += stutils::int_to_hex((end >> 8) & 0xff);
+    inst2 += stutils::int_to_hex(end & 0xff);
+
+    std::string inst3 = stutils::int_to_hex(INSTRUCTION_JGER_VALUE);
+    inst3 += stutils::int_to_hex(jump.location());
+    inst3 += stutils::int_to_hex(index.location());
+    inst3 += stutils::int_to_hex(limit.location());
+
+    // Jump through the table, the return address goes to the zero register
+    std::string inst4 = stutils::int_to_hex(INSTRUCTION_LDI_VALUE);
+    inst4 += stutils::int_to_hex(jump.location());
+    inst4 += stutils::int_to_hex((table >> 8) & 0xff);
+    inst4 += stutils::int_to_hex(table & 0xff);
+
+    std::string inst5 = stutils::int_to_hex(INSTRUCTION_ADD_VALUE);
+    inst5 += stutils::int_to_hex(jump.location());
+    inst5 += stutils::int_to_hex(jump.location());
+    inst5 += stutils::int_to_hex(index.location());
+
+    std::string inst6 = stutils::int_to_hex(INSTRUCTION_JALR_VALUE);
+    inst6 += stutils::int_to_hex(jump.location());
+    inst6 += "00";
+    inst6 += "00";
+
+    data::logMacro(inst1, data::state.line);
+    data::logMacro(inst2, COMMAND_EXPANDER, true);
+    data::logMacro(inst3, COMMAND_EXPANDER);
+    data::logMacro(inst4, COMMAND_EXPANDER, true);
+    data::logMacro(inst5, COMMAND_EXPANDER, false, true);
+    data::logMacro(inst6, COMMAND_EXPANDER, false, true);
+
+    for (auto lab = labels.begin(); lab != labels.end(); ++lab)
+    {
+        std::string jmp = stutils::int_to_hex(INSTRUCTION_JAL_VALUE);
+        jmp += "00";
+        jmp += stutils::int_to_hex((lab->location() >> 8) & 0xff);
+        jmp += stutils::int_to_hex(lab->location() & 0xff);
+        data::logMacro(jmp, COMMAND_EXPANDER, false, true);
+    }
+}
+
 void macroSub(void)
 {
     Symbol sym, dest, rs1, rs2;
@@ -695,12 +1307,107 @@ void macroSub(void)
     /*
     Push the instructions into the instruction SymbolList
     */
-    data::data.ins_list.push_back(xor_ins);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, xor_ins, data::state.line);
-    data::data.ins_list.push_back(add1);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, add1, COMMAND_EXPANDER);
-    data::data.ins_list.push_back(add2);
-    data::data.insertLog(data::state.line_number, data::state.prog_count++, add2, COMMAND_EXPANDER);
+    data::logMacro(xor_ins, data::state.line);
+    data::logMacro(add1, COMMAND_EXPANDER);
+    data::logMacro(add2, COMMAND_EXPANDER);
+}
+
+/*
+  Reads a flag operand. This is either the name of a .flag or a register and bit
+  written as reg:bit, where the bit may be a number or a .const.
+  */
+static void getFlag(Symbol &reg, int &bit)
+{
+    Token t = data::token_list.getNext();
+    std::size_t colon = t.s_value.find(':');
+    if (colon == std::string::npos)
+    {
+        Symbol sym = data::symbol_list.getSymbolFromTable(data::state.error, t.s_value, data::state.in_process, data::state.process_name);
+        if (data::state.error || sym.type() != FLAG)
+        {
+            data::setError("Expected flag or reg:bit but found -> " + t.s_value);
+            return;
+        }
+        reg = Symbol(REGISTER, 0, 1, sym.location());
+        bit = sym.value();
+        return;
+    }
+
+    std::string name = t.s_value.substr(0, colon);
+    reg = data::symbol_list.getSymbolFromTable(data::state.error, name, data::state.in_process, data::state.process_name);
+    if (data::state.error || reg.type() != REGISTER)
+    {
+        data::setError("Invalid register for flag -> " + t.s_value);
+        return;
+    }
+
+    Token b(t.s_value.substr(colon + 1));
+    bit = numutils::getIValue(b);
+    if (data::state.error)
+    {
+        data::setError("Invalid bit for flag -> " + t.s_value);
+        return;
+    }
+    if (bit < 0 || bit > 15)
+    {
+        data::setError("immediate value out of range (0 - 15)  but is value -> " + std::to_string(bit));
+        return;
+    }
+}
+
+void macroSetf(int command)
+{
+    Symbol reg;
+    int bit = 0;
+    getFlag(reg, bit);
+    if (data::state.error)
+        return;
+
+    if (!checkForMore())
+        return;
+
+    std::string inst = stutils::int_to_hex(command);
+    inst += stutils::int_to_hex(reg.location());
+    inst += stutils::int_to_hex(bit);
+    inst += stutils::int_to_hex(reg.location());
+
+    data::logMacro(inst, data::state.line);
+}
+
+void macroJfs(int command)
+{
+    Symbol sym, reg, lab;
+    getMacroRegister(sym, "1");
+    if (data::state.error == 1)
+        return;
+
+    int bit = 0;
+    getFlag(reg, bit);
+    if (data::state.error)
+        return;
+
+    if (!checkComma())
+        return;
+
+    getLabel(lab);
+    if (data::state.error)
+        return;
+
+    if (!checkForMore())
+        return;
+
+    std::string inst1 = stutils::int_to_hex(INSTRUCTION_LDI_VALUE);
+    inst1 += stutils::int_to_hex(sym.location());
+    inst1 += stutils::int_to_hex((lab.location() >> 8) & 0xff);
+    inst1 += stutils::int_to_hex(lab.location() & 0xff);
+
+    std::string inst2 = stutils::int_to_hex(command);
+    inst2 += stutils::int_to_hex(sym.location());
+    inst2 += stutils::int_to_hex(bit);
+    inst2 += stutils::int_to_hex(reg.location());
+
+    data::logMacro(inst1, data::state.line, true);
+    data::logMacro(inst2, COMMAND_EXPANDER);
 }
 
 } // namespace instructions
\ No newline at end of file
@@ -21,6 +21,19 @@
 
 #include "options.hpp"
 #include "assemble.hpp"
+#include "optimise.hpp"
+#include "loops.hpp"
+#include "inliner.hpp"
+#include "allocator.hpp"
+#include "bundle.hpp"
+#include "delta.hpp"
+#include "overlay.hpp"
+#include "pin.hpp"
+#include "process_map.hpp"
+#include "program.hpp"
+#include "profile.hpp"
+#include "usage.hpp"
+#include "wcet.hpp"
 
 #define VERSION_MAJOR 1
 #define VERSION_MINOR 0
@@ -75,6 +88,12 @@ int main(int argc, char *argv[])
         return error;
     }
 
+    if (!opts.unbundle_file.empty())
+        return bundle::unbundle(opts.unbundle_file, opts.quiet) ? error : 1;
+
+    if (!opts.delta_base.empty() && !opts.input_file.empty())
+        return delta::diff(opts.delta_base, opts.input_file, opts.quiet) ? error : 1;
+
     // The input file ha not been set
     if (opts.input_file.empty())
     {
@@ -88,6 +107,7 @@ int main(int argc, char *argv[])
 
         if (source.is_open())
         {
+            data::options = opts;
             Assemble comp(source);
             comp.go();
 
@@ -99,18 +119,46 @@ int main(int argc, char *argv[])
             else
             {
                 data::data.createConfigFile("config.v");
+                data::data.createRomFile("rom.v");
                 data::data.createDataFile(opts.data_file);
                 data::data.createProcessFile(opts.pc_file);
                 data::data.createProgramFile(opts.inst_file);
                 data::data.createRegFile(opts.reg_file);
                 data::data.createSequenceFile(opts.seq_file);
                 data::data.createListingFile(listingName(opts.input_file));
+                if (!opts.pin_file.empty())
+                    pin::writeMap(opts.pin_file);
+                if (!opts.bundle_file.empty() && !bundle::write(opts.bundle_file, listingName(opts.input_file)))
+                    error = 1;
                 if (!opts.quiet)
                 {
                     std::cout << "processes " << data::data.process_count << ", ";
                     std::cout << "registers " << data::data.reg_list.size() << ", ";
                     std::cout << "data " << data::data.data_list.size() << ", ";
                     std::cout << "instructions " << data::data.ins_list.size() << std::endl;
+                    if (!opts.pin_file.empty())
+                        pin::printReport();
+                    if (opts.usage)
+                        usage::printReport();
+                    if (!sequence_shares.empty())
+                        printSequenceReport();
+                    if (opts.min_jitter)
+                        printRevisitReport();
+                    if (opts.timing_clock > 0)
+                        printTimingReport(opts.timing_clock);
+                    if (opts.wcet)
+                        wcet::printReport();
+                    if (!opts.profile_file.empty())
+                        profile::printReport();
+                    if (!data::data.locals.empty())
+                        overlay::printReport();
+                    allocator::printReport();
+                    if (opts.inline_size > 0 || program::hasHint(INLINE))
+                        inliner::printReport();
+                    if (opts.hoist || opts.unroll_budget > 0 || program::hasHint(UNROLL))
+                        loops::printReport();
+                    if (opts.optimise)
+                        optimise::printReport();
                 }
             }
 
@@ -160,7 +208,9 @@ void showHelp(void)
     std::cout << "    <file>.lst    - listing file." << std::endl;
     std::cout << "The names of these files can be changed by the user." << std::endl;
     std::cout << "USAGE:" << std::endl;
-    std::cout << "avalanche [d <name>] [p <name>] [l <name>] [r <name>] [-v] [-q] <input file>" << std::endl;
+    std::cout << "avalanche [d <name>] [p <name>] [l <name>] [r <name>] [-v] [-q] [-O] [-H] [-U <size>] [-I <size>] [-B <size>] [-K <words>] [-T <percent>] [-J] [-R <MHz>] [-W] [-P <trace>] [-M <size>] [-G <size>] [-D <size>] [-u] [-X <words>] [-F [image=]<format>] [-b <bundle>] [-L <map>] [-S <words>] <input file>" << std::endl;
+    std::cout << "avalanche -e <bundle>" << std::endl;
+    std::cout << "avalanche -y <old build> <new build>" << std::endl;
     std::cout << "OPTIONS:" << std::endl;
     std::cout << "  -d <name> the name of the dta_data" << std::endl;
     std::cout << "  -p <name> the name of the inst_data file" << std::endl;
@@ -169,6 +219,28 @@ void showHelp(void)
     std::cout << "  -h This help text" << std::endl;
     std::cout << "  -v Display the version number" << std::endl;
     std::cout << "  -q Quitet mode, turn off the assembler memory useage output" << std::endl;
+    std::cout << "  -O Optimise each process, this can change the timing of a process" << std::endl;
+    std::cout << "  -H Hoist instructions that do not change out of loops, this can change the timing of a process" << std::endl;
+    std::cout << "  -U <size> Unroll djnz loops with a known count while the program fits in <size> instructions" << std::endl;
+    std::cout << "  -I <size> Inline subroutines of up to <size> instructions and turn calls followed by ret into jumps" << std::endl;
+    std::cout << "  -B <size> Stop inlining when the program would grow past <size> instructions" << std::endl;
+    std::cout << "  -K <words> The number of words memcpy and memset write each time round their loop, 8 by default" << std::endl;
+    std::cout << "  -T <percent> If the sequence RAM overflows build a shorter one that gives each process its share to within <percent>" << std::endl;
+    std::cout << "  -J Interleave the sequence RAM so the gaps between runs of each process are as even as they can be" << std::endl;
+    std::cout << "  -R <MHz> Report the slots, the gaps between runs and the instructions per second of each process with a clock of <MHz>" << std::endl;
+    std::cout << "  -W Work out the longest path between the .mark points of each process and show the cycles of each instruction in the listing" << std::endl;
+    std::cout << "  -P <trace> Map a trace of (process, pc) samples back to the source, report the busiest lines, labels and macros and show the samples in the listing" << std::endl;
+    std::cout << "  -M <size> The number of instructions the instruction memory holds, 1024 by default" << std::endl;
+    std::cout << "  -G <size> The number of registers, 256 by default" << std::endl;
+    std::cout << "  -D <size> The number of bytes of data RAM, 1024 by default" << std::endl;
+    std::cout << "  -u Print how much of each memory is used by each process and each macro" << std::endl;
+    std::cout << "  -X <words> Write the instruction and sequence memories of up to <words> words to rom.v as case ROMs" << std::endl;
+    std::cout << "  -F [image=]<format> Write the images, or only inst, data, pc, reg or seq, as hex, bin, ihex, coe, mem or mif" << std::endl;
+    std::cout << "  -L <map> Keep each process that still fits at the address it had in the layout map of the last build, then write the new map" << std::endl;
+    std::cout << "  -S <words> With -L, the words of room to grow given to each process that is placed afresh" << std::endl;
+    std::cout << "  -b <bundle> Write every output file to a single bundle file as well" << std::endl;
+    std::cout << "  -e <bundle> Write the files held in a bundle back out, under the names they were made with" << std::endl;
+    std::cout << "  -y <old build> <new build> Write the words that changed between two bundles or output directories to delta.txt and delta.avd" << std::endl;
 }
 
 std::string listingName(std::string &n)
@@ -0,0 +1,180 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#include "optimise.hpp"
+#include "dataflow.hpp"
+#include "program.hpp"
+#include "data.hpp"
+#include <iostream>
+
+namespace optimise
+{
+
+/*
+  The most times a process is analysed, each time round can open up more changes
+  */
+const int MAX_PASSES = 16;
+
+Report report;
+
+/*
+  Make one round of changes to a process using the results of the analysis.
+  Returns true if anything was changed.
+  */
+static bool improve(program::Code &c, dataflow::Analysis &a)
+{
+    int count = c.nodes.size();
+    bool changed = false;
+    std::vector<bool> remove(count, false);
+
+    // Writes of a value the register already holds. The write the value came from may be
+    // taken to be dead because of them, so they are only removed in a round in which 
+    // no write is removed as dead.
+    std::vector<int> same;
+    bool dead = false;
+
+    for (int i = 0; i < count; i++)
+    {
+        program::Node &n = c.nodes[i];
+        if (!a.reachable[i])
+        {
+            remove[i] = true;
+            report.removed++;
+            continue;
+        }
+        // A jump table has to stay as it is for the indexing into it to work
+        if (n.table)
+            continue;
+
+        dataflow::Values &v = a.in[i];
+        int taken = a.branch(i);
+        if (taken == 0)
+        {
+            remove[i] = true;
+            report.jumps++;
+            continue;
+        }
+        if (taken == 1)
+        {
+            int t = a.jumpTarget(i);
+            if (t >= 0)
+            {
+                n.target = t < count ? c.nodes[t].id : c.end_id;
+                n.op = 0x12;
+                n.rd = 0;
+                n.address = false;
+                report.jumps++;
+                changed = true;
+            }
+            continue;
+        }
+        if (program::isJAL(n.op) && n.rd == 0 && a.jumpTarget(i) == i + 1)
+        {
+            remove[i] = true;
+            report.jumps++;
+            continue;
+        }
+
+        if (!a.sideEffectFree(i, v))
+            continue;
+
+        dataflow::Registers d = a.defs(i, v);
+        if (d.any() && (d & a.live_out[i]).none())
+        {
+            remove[i] = true;
+            report.removed++;
+            dead = true;
+            continue;
+        }
+
+        int reg = (n.op & OPCODE_RD_INDIRECT) ? v[n.rd] : n.rd;
+        dataflow::Values out = v;
+        a.transfer(i, out);
+        int r = out[reg];
+        bool known = dataflow::isConstant(r) || (r >= dataflow::VALUE_ADDRESS && a.position(r - dataflow::VALUE_ADDRESS) >= 0);
+        if (!known)
+            continue;
+        if (r == v[reg])
+            same.push_back(i);
+        else if (!program::isLDI(n.op))
+        {
+            n.op = 0x11;
+            n.rd = reg;
+            n.address = !dataflow::isConstant(r);
+            n.target = n.address ? r - dataflow::VALUE_ADDRESS : -1;
+            n.setImm(n.address ? 0 : r);
+            report.folded++;
+            changed = true;
+        }
+    }
+
+    for (auto i = same.begin(); i != same.end() && !dead; ++i)
+    {
+        remove[*i] = true;
+        report.removed++;
+    }
+
+    for (int i = count - 1; i >= 0; i--)
+    {
+        if (remove[i] && c.nodes.size() > 1)
+        {
+            program::removeNode(c, i);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/*
+  Number of nodes in the whole program
+  */
+static int size()
+{
+    int n = 0;
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+        n += c->nodes.size();
+    return n;
+}
+
+void optimise()
+{
+    report = Report();
+    report.before = size();
+
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+    {
+        for (int pass = 0; pass < MAX_PASSES; pass++)
+        {
+            dataflow::scan();
+            dataflow::Analysis a(*c);
+            a.run();
+            if (!improve(*c, a))
+                break;
+        }
+    }
+
+    report.after = size();
+}
+
+void printReport()
+{
+    std::cout << "optimiser: instructions " << report.before << " -> " << report.after << ", ";
+    std::cout << "folded " << report.folded << ", ";
+    std::cout << "jumps " << report.jumps << ", ";
+    std::cout << "removed " << report.removed << std::endl;
+}
+
+} // namespace optimise
@@ -19,6 +19,25 @@
 #include <stdexcept>
 
 #include "options.hpp"
+#include "image.hpp"
+
+/*
+  Set the format of every image, or of one image when it is given as image=format
+  */
+void Options::setFormat(std::string s)
+{
+    std::size_t equals = s.find('=');
+    std::string name = equals == std::string::npos ? "" : s.substr(0, equals);
+    std::string format = equals == std::string::npos ? s : s.substr(equals + 1);
+    if (image::parseFormat(format) < 0)
+        throw std::invalid_argument("Unknown image format " + format + ", expected hex, bin, ihex, coe, mem or mif");
+    if (name.empty())
+        Options::image_format = format;
+    else if (name == image::IMAGE_INST || name == image::IMAGE_DATA || name == image::IMAGE_PC || name == image::IMAGE_REG || name == image::IMAGE_SEQ)
+        Options::image_formats[name] = format;
+    else
+        throw std::invalid_argument("Unknown image " + name + ", expected inst, data, pc, reg or seq");
+}
 
 void Options::processOptions(int ac, char **av)
 {
@@ -33,6 +52,28 @@ void Options::processOptions(int ac, char **av)
         {"pc-file", required_argument, 0, 'l'},
         {"reg-file", required_argument, 0, 'r'},
         {"seq-file", required_argument, 0, 's'},
+        {"optimise", no_argument, 0, 'O'},
+        {"hoist", no_argument, 0, 'H'},
+        {"unroll-budget", required_argument, 0, 'U'},
+        {"inline", required_argument, 0, 'I'},
+        {"inline-budget", required_argument, 0, 'B'},
+        {"block-unroll", required_argument, 0, 'K'},
+        {"sequence-tolerance", required_argument, 0, 'T'},
+        {"min-jitter", no_argument, 0, 'J'},
+        {"timing-report", required_argument, 0, 'R'},
+        {"wcet", no_argument, 0, 'W'},
+        {"profile", required_argument, 0, 'P'},
+        {"imem", required_argument, 0, 'M'},
+        {"regs", required_argument, 0, 'G'},
+        {"dmem", required_argument, 0, 'D'},
+        {"usage", no_argument, 0, 'u'},
+        {"rom", required_argument, 0, 'X'},
+        {"format", required_argument, 0, 'F'},
+        {"bundle", required_argument, 0, 'b'},
+        {"unbundle", required_argument, 0, 'e'},
+        {"delta", required_argument, 0, 'y'},
+        {"pin", required_argument, 0, 'L'},
+        {"slack", required_argument, 0, 'S'},
         {0, 0, 0, 0}};
 
     if (ac < 2)
@@ -45,7 +86,7 @@ void Options::processOptions(int ac, char **av)
         auto option_index = 0;
         // auto c = getopt_long(ac, av, "hdplri:", long_options, &option_index);
         int c;
-        if ((c = getopt_long(ac, av, "qvhd:p:l:r:", long_options, &option_index)) != -1) {
+        if ((c = getopt_long(ac, av, "qvhOHJWud:p:l:r:U:I:B:K:T:R:P:M:G:D:X:F:b:e:y:L:S:", long_options, &option_index)) != -1) {
             switch (c)
             { 
             case 'h':
@@ -72,6 +113,72 @@ void Options::processOptions(int ac, char **av)
             case 'q':
                 Options::quiet = true;
                 break;
+            case 'O':
+                Options::optimise = true;
+                break;
+            case 'H':
+                Options::hoist = true;
+                break;
+            case 'U':
+                Options::unroll_budget = std::stoi(optarg);
+                break;
+            case 'I':
+                Options::inline_size = std::stoi(optarg);
+                break;
+            case 'B':
+                Options::inline_budget = std::stoi(optarg);
+                break;
+            case 'K':
+                Options::block_unroll = std::stoi(optarg);
+                break;
+            case 'T':
+                Options::sequence_tolerance = std::stoi(optarg);
+                break;
+            case 'J':
+                Options::min_jitter = true;
+                break;
+            case 'R':
+                Options::timing_clock = std::stod(optarg);
+                break;
+            case 'W':
+                Options::wcet = true;
+                break;
+            case 'P':
+                Options::profile_file = optarg;
+                break;
+            case 'M':
+                Options::imem_size = std::stoi(optarg);
+                break;
+            case 'G':
+                Options::reg_size = std::stoi(optarg);
+                break;
+            case 'D':
+                Options::dmem_size = std::stoi(optarg);
+                break;
+            case 'u':
+                Options::usage = true;
+                break;
+            case 'X':
+                Options::rom_size = std::stoi(optarg);
+                break;
+            case 'F':
+                setFormat(optarg);
+                break;
+            case 'b':
+                Options::bundle_file = optarg;
+                break;
+            case 'e':
+                Options::unbundle_file = optarg;
+                break;
+            case 'y':
+                Options::delta_base = optarg;
+                break;
+            case 'L':
+                Options::pin_file = optarg;
+                break;
+            case 'S':
+                Options::slack = std::stoi(optarg);
+                break;
             case '?':
                 throw std::invalid_argument("Invalid argument");
                 break;
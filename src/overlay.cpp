@@ -0,0 +1,276 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#include "overlay.hpp"
+#include "data.hpp"
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <map>
+#include <set>
+#include <iostream>
+
+namespace overlay
+{
+
+Report report;
+
+/*
+  A call or return noted while the program was first read
+  */
+class Site
+{
+public:
+  std::string process;
+  int address = 0;
+  std::string target;
+};
+
+static std::vector<Site> calls;
+static std::vector<Site> returns;
+
+/*
+  Report an error against the line that declared the buffer
+  */
+static void localError(LocalData &l, std::string message)
+{
+    data::state.line_number = l.line_number;
+    data::state.line = l.line;
+    data::setError(message);
+}
+
+void addCall()
+{
+    Token link = data::token_list.getNext();
+    if (!data::token_list.hasNext())
+        return;
+    data::token_list.getNext();
+    if (!data::token_list.hasNext())
+        return;
+    Token target = data::token_list.getNext();
+    if (target.type != IDENTIFIER)
+        return;
+
+    // A jal that links into r0 is a jump, not a call
+    int err = 0;
+    Symbol sym = data::symbol_list.getSymbolFromTable(err, link.s_value, data::state.in_process, data::state.process_name);
+    if (!err && sym.type() == REGISTER && sym.location() == 0)
+        return;
+
+    Site s;
+    s.process = data::state.process_name;
+    s.address = data::state.prog_count;
+    s.target = target.s_value;
+    calls.push_back(s);
+}
+
+void addReturn()
+{
+    Site s;
+    s.process = data::state.process_name;
+    s.address = data::state.prog_count;
+    returns.push_back(s);
+}
+
+/*
+  Lay out the .local buffers of one process. Returns false on an error.
+  */
+static bool layoutProcess(const std::string &process)
+{
+    std::vector<LocalData *> locals;
+    for (auto l = data::data.locals.begin(); l != data::data.locals.end(); ++l)
+    {
+        if (l->process == process)
+            locals.push_back(&*l);
+    }
+
+    // Every label that is called is the start of a subroutine
+    std::vector<std::pair<int, std::string>> entries;
+    std::set<std::string> seen;
+    for (auto c = calls.begin(); c != calls.end(); ++c)
+    {
+        if (c->process != process || seen.count(c->target))
+            continue;
+        seen.insert(c->target);
+        try
+        {
+            Symbol sym = data::symbol_list.getSymbol(process + c->target);
+            if (sym.type() == LABEL)
+                entries.push_back(std::make_pair(sym.location(), c->target));
+        }
+        catch (std::invalid_argument &e)
+        {
+            // Reported when the call is assembled
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+
+    // A subroutine ends at the last ret before the next one starts
+    std::vector<int> ends;
+    for (std::size_t i = 0; i < entries.size(); i++)
+    {
+        int next = i + 1 < entries.size() ? entries[i + 1].first : INT_MAX;
+        int end = next - 1;
+        int last = -1;
+        for (auto r = returns.begin(); r != returns.end(); ++r)
+        {
+            if (r->process == process && r->address >= entries[i].first && r->address < next)
+                last = std::max(last, r->address);
+        }
+        if (last >= 0)
+            end = last;
+        ends.push_back(end);
+    }
+
+    auto owner = [&](int address) {
+        std::string o;
+        for (std::size_t i = 0; i < entries.size() && entries[i].first <= address; i++)
+            o = address <= ends[i] ? entries[i].second : "";
+        return o;
+    };
+
+    // The process itself is the subroutine with no name
+    std::map<std::string, std::set<std::string>> callers;
+    for (auto c = calls.begin(); c != calls.end(); ++c)
+    {
+        if (c->process == process)
+            callers[c->target].insert(owner(c->address));
+    }
+
+    std::map<std::string, int> frame;
+    for (auto l = locals.begin(); l != locals.end(); ++l)
+    {
+        try
+        {
+            Symbol sym = data::symbol_list.getSymbol(process + (*l)->routine);
+            if (sym.type() != LABEL)
+                throw std::invalid_argument("");
+        }
+        catch (std::invalid_argument &e)
+        {
+            localError(**l, (*l)->routine + " is not a label in this process");
+            return false;
+        }
+        if (callers[(*l)->routine].empty())
+        {
+            localError(**l, (*l)->routine + " is never called, .local data must belong to a subroutine entered with call");
+            return false;
+        }
+        frame[(*l)->routine] += (*l)->size;
+    }
+
+    // A subroutine's buffers go above those of everything that can call it
+    std::map<std::string, int> offset;
+    std::set<std::string> active;
+    std::string recursive;
+    std::function<int(const std::string &)> place = [&](const std::string &r) {
+        if (r.empty())
+            return 0;
+        auto o = offset.find(r);
+        if (o != offset.end())
+            return o->second;
+        if (active.count(r))
+        {
+            recursive = r;
+            return 0;
+        }
+        active.insert(r);
+        int v = 0;
+        for (auto c = callers[r].begin(); c != callers[r].end(); ++c)
+            v = std::max(v, place(*c) + frame[*c]);
+        active.erase(r);
+        offset[r] = v;
+        return v;
+    };
+
+    int region = 0;
+    for (auto l = locals.begin(); l != locals.end(); ++l)
+    {
+        int o = place((*l)->routine);
+        if (!recursive.empty())
+        {
+            localError(**l, recursive + " can call itself so its .local data can not be overlaid");
+            return false;
+        }
+        region = std::max(region, o + frame[(*l)->routine]);
+    }
+
+    int base = data::state.data_count;
+    std::map<std::string, int> used;
+    for (auto l = locals.begin(); l != locals.end(); ++l)
+    {
+        int address = base + offset[(*l)->routine] + used[(*l)->routine];
+        used[(*l)->routine] += (*l)->size;
+
+        std::string size = stutils::int_to_hex(((*l)->size >> 8) & 0xff);
+        size += stutils::int_to_hex((*l)->size & 0xff);
+        data::data.log((*l)->line_number, address, size, (*l)->line);
+
+        int type = DATA;
+        int val = 0;
+        std::string name = process + (*l)->name;
+        try
+        {
+            data::symbol_list.addSymbolToTable(data::state.error, type, val, (*l)->size, address, name);
+        }
+        catch (const std::exception &ex)
+        {
+            localError(**l, "Data value " + std::string(ex.what() + (*l)->name));
+            return false;
+        }
+        report.locals++;
+        report.size += (*l)->size;
+    }
+
+    int index = -1;
+    for (std::size_t i = 0; i < data::data.process_names.size(); i++)
+    {
+        if (data::data.process_names[i] + "_" == process)
+            index = i;
+    }
+    for (int i = 0; i < region; i++)
+        data::data.addData("00", index);
+    data::state.data_count += region;
+    report.used += region;
+    return true;
+}
+
+void layout()
+{
+    report = Report();
+    std::vector<std::string> processes;
+    for (auto l = data::data.locals.begin(); l != data::data.locals.end(); ++l)
+    {
+        if (std::find(processes.begin(), processes.end(), l->process) == processes.end())
+            processes.push_back(l->process);
+    }
+    for (auto p = processes.begin(); p != processes.end(); ++p)
+    {
+        if (!layoutProcess(*p))
+            break;
+    }
+    calls.clear();
+    returns.clear();
+}
+
+void printReport()
+{
+    std::cout << "local data " << report.locals << " buffers, ";
+    std::cout << "size " << report.size << ", ";
+    std::cout << "overlaid into " << report.used << std::endl;
+}
+
+} // namespace overlay
@@ -0,0 +1,155 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#include "pin.hpp"
+#include "data.hpp"
+#include "program.hpp"
+#include "string_utils.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+namespace pin
+{
+
+/*
+  Where a process sits in instruction memory
+  */
+class Slot
+{
+public:
+    int start = 0;
+    int size = 0;
+};
+
+static std::map<std::string, Slot> slots;
+
+class Report
+{
+public:
+    int kept = 0;
+    int moved = 0;
+    int placed = 0;
+    int padding = 0;
+};
+
+static Report report;
+
+/*
+  Read the layout map of the last build, if there is one
+  */
+static std::map<std::string, Slot> readMap(std::string name)
+{
+    std::map<std::string, Slot> map;
+    std::ifstream f(name);
+    std::string line;
+    while (std::getline(f, line))
+    {
+        line = stutils::stripComment(line);
+        std::stringstream s(line);
+        std::string process;
+        Slot slot;
+        if (s >> process >> slot.start >> slot.size)
+            map[process] = slot;
+    }
+    return map;
+}
+
+/*
+  The first address from which size words are free of every slot taken so far
+  */
+static int findGap(std::vector<Slot> &taken, int size)
+{
+    std::sort(taken.begin(), taken.end(), [](const Slot &a, const Slot &b) { return a.start < b.start; });
+    int at = 0;
+    for (auto t = taken.begin(); t != taken.end(); ++t)
+    {
+        if (t->start - at >= size)
+            return at;
+        at = std::max(at, t->start + t->size);
+    }
+    return at;
+}
+
+void layout()
+{
+    report = Report();
+    std::map<std::string, Slot> old = readMap(data::options.pin_file);
+    slots.clear();
+
+    std::vector<Slot> taken;
+    std::map<int, int> placed;
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+    {
+        auto o = old.find(c->name);
+        if (o != old.end() && (int)c->nodes.size() <= o->second.size)
+        {
+            slots[c->name] = o->second;
+            taken.push_back(o->second);
+            placed[c->process] = o->second.start;
+            report.kept++;
+        }
+    }
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+    {
+        if (placed.count(c->process))
+            continue;
+        if (old.count(c->name))
+            report.moved++;
+        else
+            report.placed++;
+        Slot s;
+        s.size = c->nodes.size() + std::max(0, data::options.slack);
+        s.start = findGap(taken, s.size);
+        slots[c->name] = s;
+        taken.push_back(s);
+        placed[c->process] = s.start;
+    }
+
+    program::store(placed);
+
+    for (auto i = data::data.ins_info.begin(); i != data::data.ins_info.end(); ++i)
+    {
+        if (i->process < 0)
+            report.padding++;
+    }
+}
+
+void writeMap(std::string name)
+{
+    std::ofstream f(name);
+    f << "; avasm layout map: process, start address and slot size in instructions\n";
+    for (std::size_t p = 0; p < data::data.process_names.size(); p++)
+    {
+        auto s = slots.find(data::data.process_names[p]);
+        if (s != slots.end())
+            f << s->first << " " << s->second.start << " " << s->second.size << "\n";
+    }
+    f.flush();
+    f.close();
+}
+
+void printReport()
+{
+    std::cout << "layout " << report.kept << " processes kept in place, ";
+    std::cout << report.moved << " moved, " << report.placed << " new, ";
+    std::cout << "padding " << report.padding << std::endl;
+}
+
+} // namespace pin
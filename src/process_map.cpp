@@ -18,6 +18,9 @@
 #include "process_map.hpp"
 #include "string_utils.hpp"
 #include "num_utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
 #include <iostream>
 
 ProcessData::ProcessData(std::string name, int pc_location)
@@ -50,6 +53,11 @@ int ProcessData::getNumberOfSplits()
     return locs.size();
 }
 
+int ProcessData::getWeight()
+{
+    return weight ? weight : 1;
+}
+
 std::string ProcessData::getTopName()
 {
     return top;
@@ -73,15 +81,20 @@ void ProcessData::buildLocationVector()
     loc_pos = locs.begin();
 }
 
-std::string ProcessData::getNextLocationOutput()
+int ProcessData::getNextLocation()
 {
     if (loc_pos == locs.end())
     {
         loc_pos = locs.begin();
     }
-    std::string s = stutils::int_to_hex(*loc_pos);
+    int location = *loc_pos;
     ++loc_pos;
-    return s;
+    return location;
+}
+
+std::string ProcessData::getNextLocationOutput()
+{
+    return stutils::int_to_hex(getNextLocation());
 }
 
 std::vector<ProcessData> p_list;
@@ -185,11 +198,611 @@ int getLCMForSeqData(void)
     for (auto it = p_list.begin(); it != p_list.end(); ++it)
     {
         ProcessData pc = *it;
-        vals.push_back(pc.getNumberOfSplits());
+        int splits = pc.getNumberOfSplits();
+        vals.push_back(splits / numutils::gcd(splits, pc.getWeight()));
     }
     return numutils::getLcm(vals);
 }
 
+int getSlotsPerRound(void)
+{
+    int slots = 0;
+    for (auto it = p_list.begin(); it != p_list.end(); ++it)
+        slots += it->getWeight();
+    return slots;
+}
+
+int getSequenceLength(void)
+{
+    if (!sequence.empty())
+        return sequence.size();
+    return getLCMForSeqData() * getSlotsPerRound();
+}
+
+std::vector<int> sequence;
+std::vector<SequenceShare> sequence_shares;
+std::vector<SequenceRevisit> sequence_revisits;
+
+/*
+  Share out length slots in proportion to what each process asked for, largest
+  remainders first, with at least one slot each. Returns false if that can not be done.
+  */
+static bool shareSlots(std::vector<SequenceShare> &shares, int length)
+{
+    int given = 0;
+    std::vector<std::pair<double, int>> remainders;
+    for (std::size_t i = 0; i < shares.size(); i++)
+    {
+        double quota = shares[i].requested * length;
+        shares[i].slots = std::max(1, (int)std::floor(quota));
+        given += shares[i].slots;
+        remainders.push_back(std::make_pair(shares[i].slots - quota, (int)i));
+    }
+    if (given > length)
+        return false;
+    std::sort(remainders.begin(), remainders.end());
+    for (int i = 0; given < length; i++, given++)
+        shares[remainders[i % remainders.size()].second].slots++;
+    return true;
+}
+
+/*
+  Give each entry e counts[e] of length slots so that no entry comes round again in 
+  fewer than SEQUENCE_MIN_GAP slots, counting round the end of the sequence. With idle
+  the slots left over go to an idle entry, numbered counts.size(), that may come round
+  as often as it likes. The k-th run of an entry is due between slots k * length / 
+  counts[e] and (k + 1) * length / counts[e], and every slot goes to the entry that may 
+  run in it with the earliest due slot, the one with the most slots on a tie. Returns 
+  false if that does not give every entry all of its slots.
+  */
+static bool spreadSlots(std::vector<int> &counts, int length, bool idle, std::vector<int> &slots)
+{
+    int entries = counts.size();
+    int spare = length;
+    for (auto c = counts.begin(); c != counts.end(); ++c)
+        spare -= *c;
+    if (spare < 0 || (spare > 0 && !idle))
+        return false;
+
+    std::vector<int> given(entries + 1, 0);
+    std::vector<int> last(entries, -SEQUENCE_MIN_GAP);
+    slots.clear();
+    for (int slot = 0; slot < length; slot++)
+    {
+        int best = -1;
+        int due = 0;
+        for (int e = 0; e < entries; e++)
+        {
+            int g = given[e];
+            if (g == counts[e] || slot - last[e] < SEQUENCE_MIN_GAP || slot < g * length / counts[e])
+                continue;
+            int d = ((g + 1) * length + counts[e] - 1) / counts[e] - 1;
+            if (best < 0 || d < due || (d == due && counts[e] > counts[best]))
+            {
+                best = e;
+                due = d;
+            }
+        }
+        if (best < 0 && given[entries] < spare)
+            best = entries;
+        if (best < 0)
+            return false;
+        given[best]++;
+        if (best < entries)
+            last[best] = slot;
+        slots.push_back(best);
+    }
+
+    std::vector<int> first(entries, -1);
+    for (int i = 0; i < length; i++)
+    {
+        if (slots[i] < entries && first[slots[i]] < 0)
+            first[slots[i]] = i;
+    }
+    for (int e = 0; e < entries; e++)
+    {
+        if (given[e] != counts[e] || (counts[e] > 0 && first[e] + length - last[e] < SEQUENCE_MIN_GAP))
+            return false;
+    }
+    return true;
+}
+
+/*
+  Returns true if no entry but skip comes round again in fewer than SEQUENCE_MIN_GAP 
+  slots, counting round the end of the sequence. slots[i] is the entry in each slot.
+  */
+static bool spaced(std::vector<int> &slots, int entries, int skip)
+{
+    int length = slots.size();
+    std::vector<int> first(entries, -1);
+    std::vector<int> last(entries, -1);
+    for (int i = 0; i < length; i++)
+    {
+        int e = slots[i];
+        if (e == skip)
+            continue;
+        if (first[e] < 0)
+            first[e] = i;
+        else if (i - last[e] < SEQUENCE_MIN_GAP)
+            return false;
+        last[e] = i;
+    }
+    for (int e = 0; e < entries; e++)
+    {
+        if (first[e] >= 0 && first[e] + length - last[e] < SEQUENCE_MIN_GAP)
+            return false;
+    }
+    return true;
+}
+
+bool buildApproximateSequence(int tolerance, int max)
+{
+    sequence.clear();
+    sequence_shares.clear();
+    int total = getSlotsPerRound();
+    for (auto it = p_list.begin(); it != p_list.end(); ++it)
+    {
+        for (std::size_t i = 0; i < it->locs.size(); i++)
+        {
+            SequenceShare share;
+            share.name = it->split ? it->top + "." + it->subs[i] : it->top;
+            share.location = it->locs[i];
+            share.requested = (double)it->getWeight() / total / it->locs.size();
+            sequence_shares.push_back(share);
+        }
+    }
+
+    // The shortest length within tolerance whose slots can be spread with every one
+    // at least SEQUENCE_MIN_GAP slots apart
+    std::vector<int> slots;
+    int length = sequence_shares.size();
+    for (; length <= max; length++)
+    {
+        if (!shareSlots(sequence_shares, length))
+            continue;
+        bool fits = true;
+        std::vector<int> counts;
+        for (auto s = sequence_shares.begin(); s != sequence_shares.end() && fits; ++s)
+        {
+            fits = std::fabs((double)s->slots / length - s->requested) <= s->requested * tolerance / 100.0;
+            counts.push_back(s->slots);
+        }
+        if (fits && spreadSlots(counts, length, false, slots))
+            break;
+    }
+    if (length > max)
+    {
+        sequence_shares.clear();
+        return false;
+    }
+
+    for (auto s = slots.begin(); s != slots.end(); ++s)
+        sequence.push_back(sequence_shares[*s].location);
+    return true;
+}
+
+int getIdleLocation(void)
+{
+    int locations = 0;
+    for (auto it = p_list.begin(); it != p_list.end(); ++it)
+        locations += it->locs.size();
+    return locations;
+}
+
+bool sequenceHasIdle(void)
+{
+    return std::find(sequence.begin(), sequence.end(), getIdleLocation()) != sequence.end();
+}
+
+void printSequenceReport(void)
+{
+    int length = sequence.size();
+    std::cout << "approximate sequence " << length << " entries, exact would need " << getLCMForSeqData() * getSlotsPerRound() << std::endl;
+    std::streamsize precision = std::cout.precision();
+    std::cout << std::fixed << std::setprecision(2);
+    for (auto s = sequence_shares.begin(); s != sequence_shares.end(); ++s)
+    {
+        std::cout << "  " << s->name << " requested " << s->requested * 100 << "%, ";
+        std::cout << "achieved " << 100.0 * s->slots / length << "% (" << s->slots << "/" << length << ")" << std::endl;
+    }
+    std::cout.unsetf(std::ios_base::floatfield);
+    std::cout.precision(precision);
+}
+
+/*
+  The exact sequence, round after round, with each split moving on through its parts
+  */
+static std::vector<int> exactSequence(void)
+{
+    std::vector<int> seq;
+    std::vector<int> order = getRoundOrder();
+    for (auto it = p_list.begin(); it != p_list.end(); ++it)
+        it->buildLocationVector();
+    int lcm = getLCMForSeqData();
+    for (int i = 0; i < lcm; i++)
+        for (auto p = order.begin(); p != order.end(); ++p)
+            seq.push_back(p_list[*p].getNextLocation());
+    return seq;
+}
+
+bool spaceSequence(int max)
+{
+    std::vector<int> seq = exactSequence();
+    std::vector<int> locations;
+    std::vector<int> counts;
+    std::vector<int> slots;
+    for (auto l = seq.begin(); l != seq.end(); ++l)
+    {
+        std::size_t e = std::find(locations.begin(), locations.end(), *l) - locations.begin();
+        if (e == locations.size())
+        {
+            locations.push_back(*l);
+            counts.push_back(0);
+        }
+        counts[e]++;
+        slots.push_back(e);
+    }
+    if (spaced(slots, locations.size(), -1))
+        return true;
+
+    int most = *std::max_element(counts.begin(), counts.end());
+    for (int length = std::max((int)seq.size(), most * SEQUENCE_MIN_GAP); length <= max; length++)
+    {
+        if (!spreadSlots(counts, length, true, slots))
+            continue;
+        sequence.clear();
+        for (auto s = slots.begin(); s != slots.end(); ++s)
+            sequence.push_back(*s < (int)locations.size() ? locations[*s] : getIdleLocation());
+        return true;
+    }
+    return false;
+}
+
+/*
+  The longest gap between two runs of each entry, counting round the end of the
+  sequence as it loops. slots[i] is the entry in each slot, an index into worst.
+  */
+static void worstRevisits(std::vector<int> &slots, std::vector<int> &worst)
+{
+    int length = slots.size();
+    std::vector<int> first(worst.size(), -1);
+    std::vector<int> last(worst.size(), -1);
+    std::fill(worst.begin(), worst.end(), 0);
+    for (int i = 0; i < length; i++)
+    {
+        int e = slots[i];
+        if (first[e] < 0)
+            first[e] = i;
+        else
+            worst[e] = std::max(worst[e], i - last[e]);
+        last[e] = i;
+    }
+    for (std::size_t e = 0; e < worst.size(); e++)
+        if (first[e] >= 0)
+            worst[e] = std::max(worst[e], first[e] + length - last[e]);
+}
+
+/*
+  How many times longer the worst gap is than the best each entry could have, the 
+  largest of these first, then the sum of the squares of every gap over the average
+  gap of its entry which is smallest when the gaps are even. Lower is better.
+  */
+static std::pair<double, double> jitterScore(std::vector<int> &slots, std::vector<int> &counts)
+{
+    int length = slots.size();
+    std::vector<int> first(counts.size(), -1);
+    std::vector<int> last(counts.size(), -1);
+    std::vector<int> worst(counts.size(), 0);
+    std::pair<double, double> score(0, 0);
+    for (int i = 0; i < length + length; i++)
+    {
+        int e = slots[i % length];
+        if (i >= length && i - length > first[e])
+            continue;
+        if (last[e] >= 0)
+        {
+            double gap = (double)(i - last[e]) * counts[e] / length;
+            score.second += gap * gap;
+            worst[e] = std::max(worst[e], i - last[e]);
+        }
+        else
+            first[e] = i;
+        last[e] = i;
+    }
+    for (std::size_t e = 0; e < counts.size(); e++)
+        score.first = std::max(score.first, (double)worst[e] / ((length + counts[e] - 1) / counts[e]));
+    return score;
+}
+
+/*
+  Place every run of every entry at the slot nearest where it would fall if it was 
+  spread evenly, phase is how far into its first period each entry starts.
+  */
+static std::vector<int> evenSlots(std::vector<int> &counts, int length, std::vector<double> &phase)
+{
+    std::vector<std::pair<std::pair<double, double>, int>> runs;
+    for (std::size_t e = 0; e < counts.size(); e++)
+    {
+        double period = (double)length / counts[e];
+        for (int k = 0; k < counts[e]; k++)
+            runs.push_back(std::make_pair(std::make_pair((k + phase[e]) * period, period), (int)e));
+    }
+    std::sort(runs.begin(), runs.end());
+    std::vector<int> slots;
+    for (auto r = runs.begin(); r != runs.end(); ++r)
+        slots.push_back(r->second);
+    return slots;
+}
+
+void smoothSequence(void)
+{
+    if (sequence.empty())
+        sequence = exactSequence();
+    int length = sequence.size();
+
+    sequence_revisits.clear();
+    for (auto it = p_list.begin(); it != p_list.end(); ++it)
+    {
+        for (std::size_t i = 0; i < it->locs.size(); i++)
+        {
+            SequenceRevisit revisit;
+            revisit.name = it->split ? it->top + "." + it->subs[i] : it->top;
+            revisit.location = it->locs[i];
+            sequence_revisits.push_back(revisit);
+        }
+    }
+    int idle = -1;
+    if (sequenceHasIdle())
+    {
+        SequenceRevisit revisit;
+        revisit.name = "idle";
+        revisit.location = getIdleLocation();
+        idle = sequence_revisits.size();
+        sequence_revisits.push_back(revisit);
+    }
+    std::vector<int> slots;
+    std::vector<int> counts(sequence_revisits.size(), 0);
+    for (auto l = sequence.begin(); l != sequence.end(); ++l)
+    {
+        for (std::size_t e = 0; e < sequence_revisits.size(); e++)
+        {
+            if (sequence_revisits[e].location == *l)
+            {
+                slots.push_back(e);
+                counts[e]++;
+                break;
+            }
+        }
+    }
+    std::vector<int> worst(counts.size());
+    worstRevisits(slots, worst);
+    for (std::size_t e = 0; e < counts.size(); e++)
+    {
+        sequence_revisits[e].slots = counts[e];
+        sequence_revisits[e].was = worst[e];
+    }
+
+    // Start from the best of the sequence as it is and a few even spreadings of it
+    std::vector<int> best = slots;
+    std::pair<double, double> best_score = jitterScore(best, counts);
+    int entries = counts.size();
+    for (int c = 0; c < 3; c++)
+    {
+        std::vector<double> phase(entries);
+        for (int e = 0; e < entries; e++)
+            phase[e] = c == 0 ? 0 : c == 1 ? 0.5 : (double)e / entries;
+        std::vector<int> even = evenSlots(counts, length, phase);
+        std::pair<double, double> score = jitterScore(even, counts);
+        if (score < best_score && spaced(even, entries, idle))
+        {
+            best = even;
+            best_score = score;
+        }
+    }
+
+    // Then swap nearby slots while that shortens the worst gaps and every entry still
+    // comes round no sooner than SEQUENCE_MIN_GAP slots
+    const int reach = 8;
+    for (int pass = 0; pass < 100; pass++)
+    {
+        bool better = false;
+        for (int i = 0; i < length; i++)
+        {
+            for (int d = 1; d <= reach && d < length; d++)
+            {
+                int j = (i + d) % length;
+                if (best[i] == best[j])
+                    continue;
+                std::swap(best[i], best[j]);
+                std::pair<double, double> score = jitterScore(best, counts);
+                if (score < best_score && spaced(best, entries, idle))
+                {
+                    best_score = score;
+                    better = true;
+                }
+                else
+                    std::swap(best[i], best[j]);
+            }
+        }
+        if (!better)
+            break;
+    }
+
+    worstRevisits(best, worst);
+    for (int i = 0; i < length; i++)
+        sequence[i] = sequence_revisits[best[i]].location;
+    for (std::size_t e = 0; e < counts.size(); e++)
+        sequence_revisits[e].worst = worst[e];
+}
+
+std::vector<int> getSequence(void)
+{
+    if (!sequence.empty())
+        return sequence;
+    return exactSequence();
+}
+
+/*
+  The longest gap between two runs of any of locations, counting round the end of the
+  sequence as it loops
+  */
+static int worstGap(std::vector<int> &seq, std::vector<int> &locations)
+{
+    int length = seq.size();
+    int first = -1;
+    int last = -1;
+    int worst = 0;
+    for (int i = 0; i < length; i++)
+    {
+        if (std::find(locations.begin(), locations.end(), seq[i]) == locations.end())
+            continue;
+        if (first < 0)
+            first = i;
+        else
+            worst = std::max(worst, i - last);
+        last = i;
+    }
+    if (first < 0)
+        return 0;
+    return std::max(worst, first + length - last);
+}
+
+/*
+  The slots a round of the sequence that run a new instruction for locations. A slot
+  that comes round fewer than SEQUENCE_MIN_GAP cycles after the last one that ran a new
+  instruction reads its PC before that one is written back and runs the same 
+  instruction again. Averaged over the rounds until the slot of the last new instruction
+  repeats.
+  */
+static double usableSlots(std::vector<int> &seq, std::vector<int> &locations)
+{
+    int length = seq.size();
+    double usable = 0;
+    for (auto l = locations.begin(); l != locations.end(); ++l)
+    {
+        std::vector<int> seen_round(SEQUENCE_MIN_GAP + 1, -1);
+        std::vector<long long> seen_count(SEQUENCE_MIN_GAP + 1, 0);
+        long long last = -SEQUENCE_MIN_GAP;
+        long long count = 0;
+        for (int round = 0;; round++)
+        {
+            int since = (int)std::min<long long>((long long)round * length - last, SEQUENCE_MIN_GAP);
+            if (seen_round[since] >= 0)
+            {
+                usable += (double)(count - seen_count[since]) / (round - seen_round[since]);
+                break;
+            }
+            seen_round[since] = round;
+            seen_count[since] = count;
+            for (int i = 0; i < length; i++)
+            {
+                long long t = (long long)round * length + i;
+                if (seq[i] == *l && t - last >= SEQUENCE_MIN_GAP)
+                {
+                    last = t;
+                    count++;
+                }
+            }
+        }
+    }
+    return usable;
+}
+
+/*
+  Print one line of the timing report
+  */
+static void printTiming(std::string indent, std::string name, std::vector<int> &seq, std::vector<int> locations, double mhz)
+{
+    int slots = 0;
+    for (auto l = seq.begin(); l != seq.end(); ++l)
+        slots += std::find(locations.begin(), locations.end(), *l) != locations.end();
+    double usable = usableSlots(seq, locations);
+    std::cout << indent << name << " " << slots << "/" << seq.size() << " slots, ";
+    std::cout << "every " << (double)seq.size() / slots << " cycles on average, worst " << worstGap(seq, locations) << ", ";
+    std::cout << mhz * usable / seq.size() << " MIPS";
+    if (usable < slots)
+        std::cout << ", " << slots - usable << " slots a round only rerun an instruction, coming round in under " << SEQUENCE_MIN_GAP << " cycles";
+    std::cout << std::endl;
+}
+
+long long getWorstCycles(int location, long long n)
+{
+    std::vector<int> seq = getSequence();
+    std::vector<int> at;
+    for (std::size_t i = 0; i < seq.size(); i++)
+    {
+        if (seq[i] == location)
+            at.push_back(i);
+    }
+    int slots = at.size();
+    if (slots == 0 || n <= 0)
+        return 0;
+
+    long long rounds = n / slots;
+    int rest = n % slots;
+    long long worst = 0;
+    for (int start = 0; start < slots; start++)
+    {
+        int end = start + rest;
+        long long gaps = at[end % slots] - at[start] + (end >= slots ? seq.size() : 0);
+        worst = std::max(worst, gaps);
+    }
+    return rounds * seq.size() + worst;
+}
+
+void printTimingReport(double mhz)
+{
+    std::vector<int> seq = getSequence();
+    std::cout << "timing at " << mhz << " MHz, sequence " << seq.size() << " slots" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (auto it = p_list.begin(); it != p_list.end(); ++it)
+    {
+        printTiming("  ", it->top, seq, it->locs, mhz);
+        for (std::size_t i = 0; i < it->locs.size() && it->split; i++)
+            printTiming("    ", it->top + "." + it->subs[i], seq, std::vector<int>(1, it->locs[i]), mhz);
+    }
+    int idle = std::count(seq.begin(), seq.end(), getIdleLocation());
+    if (idle > 0)
+        std::cout << "  idle " << idle << "/" << seq.size() << " slots" << std::endl;
+    std::cout.unsetf(std::ios_base::floatfield);
+}
+
+void printRevisitReport(void)
+{
+    int length = sequence.size();
+    std::cout << "sequence interleaved for jitter, " << length << " entries" << std::endl;
+    std::streamsize precision = std::cout.precision();
+    std::cout << std::fixed << std::setprecision(2);
+    for (auto r = sequence_revisits.begin(); r != sequence_revisits.end(); ++r)
+    {
+        std::cout << "  " << r->name << " revisited every " << (double)length / r->slots << " on average, ";
+        std::cout << "worst " << r->worst << " (was " << r->was << ")" << std::endl;
+    }
+    std::cout.unsetf(std::ios_base::floatfield);
+    std::cout.precision(precision);
+}
+
+std::vector<int> getRoundOrder(void)
+{
+    // Smooth weighted round robin, every slot goes to the process furthest behind its share
+    int total = getSlotsPerRound();
+    std::vector<int> current(p_list.size(), 0);
+    std::vector<int> order;
+    for (int slot = 0; slot < total; slot++)
+    {
+        int best = 0;
+        for (std::size_t p = 0; p < p_list.size(); p++)
+        {
+            current[p] += p_list[p].getWeight();
+            if (current[p] > current[best])
+                best = p;
+        }
+        current[best] -= total;
+        order.push_back(best);
+    }
+    return order;
+}
+
 ProcessData* getProcessWithTopName(std::string name)
 {
     std::size_t found = name.find(".");
@@ -0,0 +1,236 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#include "profile.hpp"
+#include "data.hpp"
+#include "string_utils.hpp"
+#include "token.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+
+namespace profile
+{
+
+long long total = 0;
+long long outside = 0;
+long long foreign = 0;
+
+std::vector<Spot> lines;
+std::vector<Spot> labels;
+std::vector<Spot> macros;
+
+/*
+  The number of spots of each kind printed in the report
+  */
+static const size_t REPORT_SIZE = 10;
+
+/*
+  A source line and the label it comes under
+  */
+class Source
+{
+public:
+    std::string text;
+    std::string label;
+};
+
+/*
+  Go through the source file and find the label each line comes under, the closest 
+  label above it in its process, or the process itself when there is none
+  */
+static std::vector<Source> readSource()
+{
+    std::vector<Source> source(1);
+    std::ifstream f(data::options.input_file);
+    std::regex label("^(\\w+)\\s*:.*$");
+    std::regex process("^" + PROC + "\\s+([\\w.]+).*$");
+    std::string current;
+    std::string line;
+    std::smatch match;
+    while (std::getline(f, line))
+    {
+        Source s;
+        s.text = stutils::stripComment(line);
+        stutils::trim(s.text);
+        if (std::regex_match(s.text, match, process))
+            current = match[1];
+        else if (s.text == EPROC)
+            current = "";
+        else if (std::regex_match(s.text, match, label))
+            current = current.substr(0, current.find(' ')) + " " + match[1].str();
+        s.label = current;
+        source.push_back(s);
+    }
+    return source;
+}
+
+/*
+  Sort spots busiest first, keeping the order they are in when they are as busy
+  */
+static void busiestFirst(std::vector<Spot> &spots)
+{
+    std::stable_sort(spots.begin(), spots.end(), [](const Spot &a, const Spot &b) {
+        return a.samples > b.samples;
+    });
+}
+
+/*
+  The spots with samples, busiest first
+  */
+static std::vector<Spot> rank(std::map<std::string, long long> &counts)
+{
+    std::vector<Spot> spots;
+    for (auto c = counts.begin(); c != counts.end(); ++c)
+    {
+        Spot s;
+        s.name = c->first;
+        s.samples = c->second;
+        spots.push_back(s);
+    }
+    busiestFirst(spots);
+    return spots;
+}
+
+/*
+  A number of samples as a percentage of all of them
+  */
+static std::string percent(long long samples)
+{
+    std::stringstream s;
+    s << std::fixed << std::setprecision(1) << (100.0 * samples / (total ? total : 1)) << "%";
+    return s.str();
+}
+
+void load(std::string name)
+{
+    std::ifstream f(name);
+    if (!f.is_open())
+    {
+        data::setError("Can not open the profile trace " + name);
+        return;
+    }
+
+    std::vector<long long> samples(data::data.ins_list.size());
+    std::string line;
+    int n = 0;
+    while (std::getline(f, line))
+    {
+        n++;
+        std::string text = line;
+        stutils::trim(text);
+        if (text.empty() || text[0] == ';' || text[0] == '#')
+            continue;
+        std::replace(text.begin(), text.end(), '(', ' ');
+        std::replace(text.begin(), text.end(), ')', ' ');
+        std::replace(text.begin(), text.end(), ',', ' ');
+        std::stringstream s(text);
+        unsigned int process, pc;
+        std::string extra;
+        if (!(s >> std::hex >> process >> pc) || (s >> extra))
+        {
+            data::state.line_number = n;
+            data::state.line = line;
+            data::setError("Expected a process and a PC in the profile trace " + name);
+            return;
+        }
+        total++;
+        if (pc >= samples.size())
+        {
+            outside++;
+            continue;
+        }
+        if ((int)process != data::data.ins_info[pc].process)
+            foreign++;
+        samples[pc]++;
+    }
+
+    std::vector<Source> source = readSource();
+    std::map<int, long long> line_counts;
+    std::map<std::string, long long> label_counts;
+    std::map<std::string, long long> macro_counts;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        if (!samples[i])
+            continue;
+        int ln = data::data.ins_info[i].line_number;
+        line_counts[ln] += samples[i];
+        auto m = data::data.macro_lines.find(ln);
+        if (m != data::data.macro_lines.end())
+            macro_counts[m->second] += samples[i];
+        if (ln > 0 && ln < (int)source.size())
+            label_counts[source[ln].label] += samples[i];
+    }
+
+    lines.clear();
+    for (auto l = line_counts.begin(); l != line_counts.end(); ++l)
+    {
+        Spot s;
+        s.name = "line " + std::to_string(l->first);
+        if (l->first > 0 && l->first < (int)source.size())
+            s.name += "  " + source[l->first].text;
+        s.samples = l->second;
+        lines.push_back(s);
+    }
+    busiestFirst(lines);
+    labels = rank(label_counts);
+    macros = rank(macro_counts);
+
+    std::vector<ListingLine> &listing = data::data.getListing();
+    for (auto l = listing.begin(); l != listing.end(); ++l)
+    {
+        for (auto e = l->inserted.begin(); e != l->inserted.end(); ++e)
+        {
+            if (e->kind == LISTING_INSTRUCTION && e->location >= 0 && e->location < (int)samples.size() && samples[e->location])
+                e->samples = percent(samples[e->location]);
+        }
+        ListingEntry &e = l->main;
+        if (e.kind == LISTING_INSTRUCTION && e.location >= 0 && e.location < (int)samples.size() && samples[e.location])
+            e.samples = percent(samples[e.location]);
+    }
+}
+
+/*
+  Print the busiest few spots of one kind
+  */
+static void printSpots(std::string title, std::vector<Spot> &spots)
+{
+    if (spots.empty())
+        return;
+    std::cout << "  " << title << std::endl;
+    for (size_t i = 0; i < spots.size() && i < REPORT_SIZE; i++)
+        std::cout << "  " << std::right << std::setw(7) << percent(spots[i].samples) << "  " << spots[i].name << std::endl;
+}
+
+void printReport()
+{
+    std::cout << "profile " << total << " samples";
+    if (outside)
+        std::cout << ", " << outside << " outside the program";
+    if (foreign)
+        std::cout << ", " << foreign << " in the code of another process";
+    std::cout << std::endl;
+    printSpots("source lines", lines);
+    printSpots("labels", labels);
+    printSpots("macros", macros);
+}
+
+} // namespace profile
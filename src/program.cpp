@@ -0,0 +1,402 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+#include "program.hpp"
+#include "data.hpp"
+#include "string_utils.hpp"
+#include <algorithm>
+
+namespace program
+{
+
+std::vector<Code> code;
+
+/*
+  Removed node id -> the id of the node that replaced it
+  */
+static std::map<int, int> forward;
+
+/*
+  The next id to give to a node made by a pass
+  */
+static int next_id = 0;
+
+int Node::imm()
+{
+    return ((rs1 & 0xff) << 8) | (rs2 & 0xff);
+}
+
+void Node::setImm(int v)
+{
+    rs1 = (v >> 8) & 0xff;
+    rs2 = v & 0xff;
+}
+
+int Code::indexOf(int id)
+{
+    if (id == end_id)
+        return nodes.size();
+    for (std::size_t i = 0; i < nodes.size(); i++)
+    {
+        if (nodes[i].id == id)
+            return i;
+    }
+    return -1;
+}
+
+bool isALU(int op)
+{
+    int base = op & 0x3f;
+    return base == 0x00 || (base >= 0x02 && base <= 0x07);
+}
+
+bool isBitOp(int op)
+{
+    int base = op & 0x3f;
+    return base == 0x06 || base == 0x07;
+}
+
+bool isLDI(int op)
+{
+    return op == 0x11;
+}
+
+bool isJAL(int op)
+{
+    return op == 0x12;
+}
+
+bool isJZ(int op)
+{
+    return op == 0x94 || op == 0x95;
+}
+
+bool isJALR(int op)
+{
+    return isRegisterJump(op) && (op & 0x07) == 0x00;
+}
+
+bool isRegisterJump(int op)
+{
+    return (op & 0x38) == 0x18 && (op & 0x07) != 0x07;
+}
+
+bool isConditionalJump(int op)
+{
+    return isJZ(op) || (isRegisterJump(op) && !isJALR(op));
+}
+
+bool hasAddress(Node &n)
+{
+    return isJAL(n.op) || isJZ(n.op) || (isLDI(n.op) && n.address);
+}
+
+Node makeNode(int op, int rd, int rs1, int rs2)
+{
+    Node n;
+    n.id = next_id++;
+    n.op = op;
+    n.rd = rd;
+    n.rs1 = rs1;
+    n.rs2 = rs2;
+    return n;
+}
+
+int resolve(int id)
+{
+    auto it = forward.find(id);
+    while (it != forward.end())
+    {
+        id = it->second;
+        it = forward.find(id);
+    }
+    return id;
+}
+
+void removeNode(Code &c, int index)
+{
+    int id = c.nodes[index].id;
+    int next = (index + 1) < (int)c.nodes.size() ? c.nodes[index + 1].id : c.end_id;
+    forward[id] = next;
+    for (auto it = c.nodes.begin(); it != c.nodes.end(); ++it)
+    {
+        if (it->target == id)
+            it->target = next;
+    }
+    c.nodes.erase(c.nodes.begin() + index);
+}
+
+void redirect(int id, int to)
+{
+    forward[id] = to;
+    for (auto c = code.begin(); c != code.end(); ++c)
+    {
+        for (auto n = c->nodes.begin(); n != c->nodes.end(); ++n)
+        {
+            if (n->target == id)
+                n->target = to;
+        }
+    }
+}
+
+void insertNode(Code &c, int index, Node n)
+{
+    c.nodes.insert(c.nodes.begin() + index, n);
+}
+
+int findHint(Code &c, int i, const std::string &name)
+{
+    int line = c.nodes[i].line_number;
+    for (std::size_t h = 0; h < data::data.hints.size(); h++)
+    {
+        Hint &hint = data::data.hints[h];
+        if (hint.name != name || hint.process != c.process || hint.line_number >= line)
+            continue;
+        bool between = false;
+        for (auto n = c.nodes.begin(); n != c.nodes.end(); ++n)
+        {
+            if (n->line_number > hint.line_number && n->line_number < line)
+                between = true;
+        }
+        if (!between)
+            return h;
+    }
+    return -1;
+}
+
+bool hasHint(const std::string &name)
+{
+    for (auto h = data::data.hints.begin(); h != data::data.hints.end(); ++h)
+    {
+        if (h->name == name)
+            return true;
+    }
+    return false;
+}
+
+void load()
+{
+    code.clear();
+    forward.clear();
+
+    int count = data::data.ins_list.size();
+    next_id = count;
+
+    for (std::size_t p = 0; p < data::data.pc_list.size(); p++)
+    {
+        Code c;
+        c.process = p;
+        c.name = p < data::data.process_names.size() ? data::data.process_names[p] : "";
+        c.end_id = next_id++;
+        code.push_back(c);
+    }
+
+    // Which process ends at each address, used to tell a label at the end of a 
+    // process from the start of the process that follows it.
+    std::map<int, int> ends;
+
+    for (int i = 0; i < count; i++)
+    {
+        InstructionInfo &info = data::data.ins_info[i];
+        unsigned long word = std::stoul(data::data.ins_list[i], 0, 16);
+        Node n;
+        n.id = i;
+        n.op = (word >> 24) & 0xff;
+        n.rd = (word >> 16) & 0xff;
+        n.rs1 = (word >> 8) & 0xff;
+        n.rs2 = word & 0xff;
+        n.address = info.address;
+        n.table = info.table;
+        n.ins = i;
+        n.anchor = i;
+        n.line_number = info.line_number;
+        if (info.process >= 0 && info.process < (int)code.size())
+            code[info.process].nodes.push_back(n);
+    }
+    for (auto c = code.begin(); c != code.end(); ++c)
+    {
+        if (!c->nodes.empty())
+            ends[c->nodes.back().ins + 1] = c->process;
+    }
+
+    // Addresses are the same as the ids of the loaded nodes so the targets can be set directly
+    for (auto c = code.begin(); c != code.end(); ++c)
+    {
+        for (auto n = c->nodes.begin(); n != c->nodes.end(); ++n)
+        {
+            if (!hasAddress(*n))
+                continue;
+            int a = n->imm();
+            auto e = ends.find(a);
+            if (e != ends.end() && e->second == c->process)
+                n->target = c->end_id;
+            else if (a < count)
+                n->target = a;
+        }
+    }
+
+    // The listing text of each instruction is taken from the listing so that 
+    // macro expansions keep their marker
+    std::vector<ListingLine> &listing = data::data.getListing();
+    std::vector<std::string> text(count);
+    for (auto l = listing.begin(); l != listing.end(); ++l)
+    {
+        for (auto e = l->inserted.begin(); e != l->inserted.end(); ++e)
+        {
+            if (e->kind == LISTING_INSTRUCTION && e->location >= 0 && e->location < count)
+                text[e->location] = e->line;
+        }
+        if (l->main.kind == LISTING_INSTRUCTION && l->main.location >= 0 && l->main.location < count)
+            text[l->main.location] = l->main.line;
+    }
+    for (auto c = code.begin(); c != code.end(); ++c)
+    {
+        for (auto n = c->nodes.begin(); n != c->nodes.end(); ++n)
+            n->text = text[n->ins];
+    }
+}
+
+/*
+  Turn a node back into its 32 bit hex string
+  */
+static std::string encode(Node &n)
+{
+    std::string s = stutils::int_to_hex(n.op);
+    s += stutils::int_to_hex(n.rd);
+    s += stutils::int_to_hex(n.rs1);
+    s += stutils::int_to_hex(n.rs2);
+    return s;
+}
+
+void store(const std::map<int, int> &origins)
+{
+    std::map<int, int> address;
+    std::vector<int> starts;
+
+    int pc = 0;
+    int size = 0;
+    for (auto c = code.begin(); c != code.end(); ++c)
+    {
+        auto p = origins.find(c->process);
+        if (p != origins.end())
+            pc = p->second;
+        starts.push_back(pc);
+        for (auto n = c->nodes.begin(); n != c->nodes.end(); ++n)
+            address[n->id] = pc++;
+        address[c->end_id] = pc;
+        size = std::max(size, pc);
+    }
+
+    // Words between placed processes are left as padding that belongs to no process
+    std::vector<std::string> ins_list(size, PADDING);
+    std::vector<InstructionInfo> ins_info(size);
+    // old instruction index -> (address, node) of every node listed with it
+    std::map<int, std::vector<std::pair<int, Node *>>> groups;
+
+    for (auto c = code.begin(); c != code.end(); ++c)
+    {
+        for (auto n = c->nodes.begin(); n != c->nodes.end(); ++n)
+        {
+            if (n->target >= 0)
+            {
+                auto a = address.find(resolve(n->target));
+                if (a != address.end())
+                    n->setImm(a->second);
+            }
+            InstructionInfo info;
+            info.line_number = n->line_number;
+            info.process = c->process;
+            info.address = n->address;
+            info.table = n->table;
+            ins_list[address[n->id]] = encode(*n);
+            ins_info[address[n->id]] = info;
+            groups[n->anchor].push_back(std::make_pair(address[n->id], &*n));
+        }
+    }
+
+    int old_count = data::data.ins_list.size();
+    data::data.ins_list = ins_list;
+    data::data.ins_info = ins_info;
+
+    for (std::size_t p = 0; p < data::data.pc_list.size() && p < starts.size(); p++)
+    {
+        int s = starts[p];
+        data::data.pc_list[p] = stutils::int_to_hex((s >> 8) & 0xff) + stutils::int_to_hex(s & 0xff);
+    }
+
+    std::vector<ListingLine> &listing = data::data.getListing();
+    std::size_t process = 0;
+    for (std::size_t l = 0; l < listing.size(); l++)
+    {
+        ListingLine &line = listing[l];
+        std::vector<int> anchors;
+        std::vector<ListingEntry> kept;
+        std::string source;
+
+        for (auto e = line.inserted.begin(); e != line.inserted.end(); ++e)
+        {
+            if (e->kind != LISTING_INSTRUCTION)
+                kept.push_back(*e);
+            else
+            {
+                anchors.push_back(e->location);
+                if (source.empty())
+                    source = e->line;
+            }
+        }
+        if (line.main.kind == LISTING_INSTRUCTION)
+        {
+            anchors.push_back(line.main.location);
+            source = line.main.line;
+            line.main = ListingEntry();
+        }
+        else if (line.main.kind == LISTING_PROCESS)
+        {
+            if (process < starts.size())
+                line.main.location = starts[process];
+            process++;
+        }
+        else if (line.main.kind == LISTING_ADDRESS)
+        {
+            int id = line.main.location < old_count ? line.main.location : (code.empty() ? -1 : code.back().end_id);
+            auto a = address.find(resolve(id));
+            if (a != address.end())
+                line.main.location = a->second;
+        }
+        if (anchors.empty())
+            continue;
+
+        line.inserted = kept;
+        bool placed = false;
+        for (auto a = anchors.begin(); a != anchors.end(); ++a)
+        {
+            auto g = groups.find(*a);
+            if (g == groups.end())
+                continue;
+            std::sort(g->second.begin(), g->second.end(),
+                      [](const std::pair<int, Node *> &x, const std::pair<int, Node *> &y) { return x.first < y.first; });
+            for (auto n = g->second.begin(); n != g->second.end(); ++n)
+                data::data.insertLog(l + 1, n->first, encode(*n->second), n->second->text, LISTING_INSTRUCTION);
+            groups.erase(g);
+            placed = true;
+        }
+        // Every instruction of the line has been removed, the source is still shown
+        if (!placed)
+            data::data.log(l + 1, -1, "", source);
+    }
+}
+
+} // namespace program
@@ -16,6 +16,7 @@
  */
 #include "symbols.hpp"
 #include "symbol_list.hpp"
+#include <stdexcept>
 
 int Symbol::type(void)
 {
@@ -71,6 +71,16 @@ std::vector<std::string> Token::macros = [] {
     m.push_back(MACRO_LD);
     m.push_back(MACRO_ST);
     m.push_back(MACRO_MOV);
+    m.push_back(MACRO_MUL);
+    m.push_back(MACRO_DIV);
+    m.push_back(MACRO_MOD);
+    m.push_back(MACRO_MEMCPY);
+    m.push_back(MACRO_MEMSET);
+    m.push_back(MACRO_SWITCH);
+    m.push_back(MACRO_SETF);
+    m.push_back(MACRO_CLRF);
+    m.push_back(MACRO_JFS);
+    m.push_back(MACRO_JFC);
     return m;
 }();
 
@@ -139,6 +149,10 @@ int Token::checkType(void)
     {
         type = REGISTER;
     }
+    else if (s_value == VRG)
+    {
+        type = VREG;
+    }
     else if (s_value == CON)
     {
         type = CONST;
@@ -147,6 +161,22 @@ int Token::checkType(void)
     {
         type = DATA;
     }
+    else if (s_value == LOC)
+    {
+        type = LOCAL;
+    }
+    else if (s_value == ROD)
+    {
+        type = RODATA;
+    }
+    else if (s_value == FLG)
+    {
+        type = FLAG;
+    }
+    else if (s_value == UNROLL || s_value == INLINE || s_value == NOINLINE || s_value == LOOPBOUND || s_value == MARK)
+    {
+        type = HINT;
+    }
     else
     {
         return 0;
@@ -0,0 +1,109 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#include "usage.hpp"
+#include "data.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace usage
+{
+
+/*
+  Check one memory against its size
+  */
+static void checkMemory(std::string memory, std::size_t used, int size)
+{
+    if ((int)used > size && !data::state.error)
+        data::setError(memory + " overflow (" + std::to_string(used) + "/" + std::to_string(size) + ")");
+}
+
+void check()
+{
+    checkMemory("Instruction memory", data::data.ins_list.size(), data::options.imem_size);
+    checkMemory("Register", data::data.reg_list.size(), data::options.reg_size);
+    checkMemory("Data memory", data::data.data_list.size(), data::options.dmem_size);
+}
+
+/*
+  The amount of a memory used as a fraction of its size
+  */
+static std::string share(std::string memory, std::size_t used, int size)
+{
+    std::stringstream s;
+    s << memory << " " << used << "/" << size << " " << std::fixed << std::setprecision(1)
+      << (size > 0 ? 100.0 * used / size : 0) << "%";
+    return s.str();
+}
+
+void printReport()
+{
+    std::cout << "memory " << share("instructions", data::data.ins_list.size(), data::options.imem_size);
+    std::cout << ", " << share("registers", data::data.reg_list.size(), data::options.reg_size);
+    std::cout << ", " << share("data", data::data.data_list.size(), data::options.dmem_size) << std::endl;
+
+    // Index 0 holds what was declared outside of any process
+    std::size_t count = data::data.process_names.size() + 1;
+    std::vector<int> instructions(count), registers(count), bytes(count);
+    std::map<std::string, int> macros;
+    for (auto i = data::data.ins_info.begin(); i != data::data.ins_info.end(); ++i)
+    {
+        if (i->process + 1 < (int)count)
+            instructions[i->process + 1]++;
+        auto m = data::data.macro_lines.find(i->line_number);
+        if (m != data::data.macro_lines.end())
+            macros[m->second]++;
+    }
+    for (auto r = data::data.reg_process.begin(); r != data::data.reg_process.end(); ++r)
+    {
+        if (*r + 1 < (int)count)
+            registers[*r + 1]++;
+    }
+    for (auto d = data::data.data_process.begin(); d != data::data.data_process.end(); ++d)
+    {
+        if (*d + 1 < (int)count)
+            bytes[*d + 1]++;
+    }
+
+    std::size_t width = 8;
+    for (auto n = data::data.process_names.begin(); n != data::data.process_names.end(); ++n)
+        width = std::max(width, n->size() + 2);
+    for (auto m = macros.begin(); m != macros.end(); ++m)
+        width = std::max(width, m->first.size() + 2);
+
+    std::cout << "  " << std::left << std::setw(width) << "process" << std::right << std::setw(13) << "instructions"
+              << std::setw(11) << "registers" << std::setw(7) << "data" << std::endl;
+    for (std::size_t p = 0; p < count; p++)
+    {
+        if (p == 0 && !instructions[p] && !registers[p] && !bytes[p])
+            continue;
+        std::string name = p == 0 ? "global" : data::data.process_names[p - 1];
+        std::cout << "  " << std::left << std::setw(width) << name << std::right << std::setw(13) << instructions[p]
+                  << std::setw(11) << registers[p] << std::setw(7) << bytes[p] << std::endl;
+    }
+    if (macros.empty())
+        return;
+    std::cout << "  " << std::left << std::setw(width) << "macro" << std::right << std::setw(13) << "instructions" << std::endl;
+    for (auto m = macros.begin(); m != macros.end(); ++m)
+        std::cout << "  " << std::left << std::setw(width) << m->first << std::right << std::setw(13) << m->second << std::endl;
+}
+
+} // namespace usage
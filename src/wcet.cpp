@@ -0,0 +1,404 @@
+/*
+ *  
+ *  Copyright(C) 2018 Gerald Coe, Devantech Ltd <gerry@devantech.co.uk>
+ * 
+ *  Permission to use, copy, modify, and/or distribute this software for any purpose with or
+ *  without fee is hereby granted, provided that the above copyright notice and 
+ *  this permission notice appear in all copies.
+ * 
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH REGARD TO
+ *  THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. 
+ *  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL 
+ *  DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN
+ *  AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN 
+ *  CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ * 
+ */
+
+#include "wcet.hpp"
+#include "data.hpp"
+#include "dataflow.hpp"
+#include "loops.hpp"
+#include "process_map.hpp"
+#include "program.hpp"
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace wcet
+{
+
+std::vector<Section> sections;
+
+/*
+  A longest path, the instructions on it, the position of the .mark it ends at, or 
+  END_RETURN, END_PROCESS or END_LOOP, and the line of a loop on it with no bound
+  */
+class Path
+{
+public:
+    long long cost = 0;
+    int end = END_RETURN;
+    int unbounded = 0;
+};
+
+/*
+  Timing
+
+  The control flow of one process with calls stepped over, and the longest paths 
+  through it. Loops are taken as a single step that costs their bound times the longest
+  way round them, followed by the longest way out of them.
+  */
+class Timing
+{
+public:
+    Timing(dataflow::Analysis &analysis);
+
+    dataflow::Analysis &a;
+    program::Code &c;
+    int count;
+
+    /*
+    Successors of each node with calls going on to the node after the call
+    */
+    std::vector<std::vector<int>> succ;
+
+    /*
+    The position a call jumps to, -1 for any other node
+    */
+    std::vector<int> callee;
+
+    /*
+    The .mark hint on each node, -1 for none
+    */
+    std::vector<int> mark;
+
+    std::vector<loops::Loop> found;
+    std::vector<long long> bound;
+
+    /*
+    The loop headed by each node, -1 for none
+    */
+    std::vector<int> loop_at;
+
+    /*
+    The longest path from a node to a .mark, a return or the end of the process when 
+    scope is -1, or to the end of one time round the loop scope
+    */
+    Path longest(int v, int scope);
+
+private:
+    std::map<std::pair<int, int>, Path> memo;
+    std::set<std::pair<int, int>> busy;
+
+    Path edge(int t, int scope);
+    Path total(int l);
+    Path exits(int l, int scope);
+};
+
+/*
+  Keep the longer of two paths, a loop with no bound on either is kept
+  */
+static void longer(Path &best, Path p, bool first)
+{
+    int unbounded = best.unbounded ? best.unbounded : p.unbounded;
+    if (first || p.cost > best.cost)
+        best = p;
+    best.unbounded = unbounded;
+}
+
+Timing::Timing(dataflow::Analysis &analysis) : a(analysis), c(analysis.code)
+{
+    count = c.nodes.size();
+    succ = a.succ;
+    callee.assign(count, -1);
+    mark.assign(count, -1);
+    loop_at.assign(count, -1);
+
+    // A jump that keeps its return address is a call and a jalr back through the 
+    // register it jumps to is a ret, which ends the path through a subroutine
+    dataflow::Analysis g = a;
+    g.unknown_entry.assign(count, false);
+    for (int i = 0; i < count; i++)
+    {
+        program::Node &n = c.nodes[i];
+        if (program::isJALR(n.op) && n.rd == n.rs1 && !n.table)
+        {
+            succ[i].clear();
+            continue;
+        }
+        bool link = (program::isJAL(n.op) && n.rd != 0) || (program::isJALR(n.op) && n.rs1 != 0 && !n.table);
+        if (!link || a.succ[i].size() != 1 || a.succ[i][0] >= count)
+            continue;
+        callee[i] = a.succ[i][0];
+        succ[i].assign(1, i + 1);
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (callee[i] >= 0)
+            g.unknown_entry[callee[i]] = true;
+    }
+
+    // Loops are found with calls stepped over and each subroutine entered on its own.
+    // Only the jumps the analysis can follow are taken, a jump through a register 
+    // that it can not follow ends the path like a ret.
+    g.succ = succ;
+    g.reachable.assign(count, false);
+    std::vector<int> work;
+    for (int i = 0; i < count; i++)
+    {
+        if (i == 0 || g.unknown_entry[i])
+            work.push_back(i);
+    }
+    while (!work.empty())
+    {
+        int i = work.back();
+        work.pop_back();
+        if (i >= count || g.reachable[i])
+            continue;
+        g.reachable[i] = true;
+        for (auto s = succ[i].begin(); s != succ[i].end(); ++s)
+            work.push_back(*s);
+    }
+    std::vector<std::vector<bool>> dom = loops::dominators(g);
+    found = loops::findLoops(g, dom);
+
+    for (std::size_t l = 0; l < found.size(); l++)
+    {
+        loop_at[found[l].head] = l;
+        long long b = 0;
+        int hint = program::findHint(c, found[l].head, LOOPBOUND);
+        bool calls = false;
+        for (int i = 0; i < count; i++)
+            calls = calls || (found[l].body[i] && callee[i] >= 0);
+        if (hint >= 0)
+            b = data::data.hints[hint].value;
+        else if (!calls)
+            b = loops::tripCount(g, found[l]);
+        bound.push_back(b);
+    }
+
+    // A .mark belongs to the first node that follows it
+    std::set<int> used;
+    for (int i = 0; i < count; i++)
+    {
+        int hint = program::findHint(c, i, MARK);
+        if (hint >= 0 && used.insert(hint).second)
+            mark[i] = hint;
+    }
+}
+
+Path Timing::edge(int t, int scope)
+{
+    if (scope >= 0 && (t == found[scope].head || t >= count || !found[scope].body[t]))
+        return Path();
+    Path p;
+    if (t >= count)
+    {
+        p.end = END_PROCESS;
+        return p;
+    }
+    if (mark[t] >= 0)
+    {
+        p.end = t;
+        return p;
+    }
+    int l = loop_at[t];
+    if (l < 0)
+        return longest(t, scope);
+
+    // Going into a loop, or back round the loop the path started in. Either way the 
+    // loop is taken to go round as often as it can.
+    Path in = total(l);
+    p = exits(l, scope);
+    p.cost += in.cost;
+    if (!p.unbounded)
+        p.unbounded = in.unbounded;
+    return p;
+}
+
+Path Timing::total(int l)
+{
+    Path round = longest(found[l].head, l);
+    long long b = bound[l];
+    if (b <= 0)
+    {
+        round.unbounded = c.nodes[found[l].head].line_number;
+        b = 1;
+    }
+    round.cost *= b;
+    return round;
+}
+
+Path Timing::exits(int l, int scope)
+{
+    Path best;
+    bool first = true;
+    for (int u = 0; u < count; u++)
+    {
+        if (!found[l].body[u])
+            continue;
+        if (succ[u].empty())
+        {
+            longer(best, Path(), first);
+            first = false;
+        }
+        for (auto t = succ[u].begin(); t != succ[u].end(); ++t)
+        {
+            if (*t < count && found[l].body[*t])
+                continue;
+            longer(best, edge(*t, scope), first);
+            first = false;
+        }
+    }
+    if (first)
+        best.end = END_LOOP;
+    return best;
+}
+
+Path Timing::longest(int v, int scope)
+{
+    std::pair<int, int> key(v, scope);
+    auto m = memo.find(key);
+    if (m != memo.end())
+        return m->second;
+    if (busy.count(key))
+    {
+        // Round a loop that is not entered through a single head
+        Path p;
+        p.unbounded = c.nodes[v].line_number;
+        return p;
+    }
+    busy.insert(key);
+
+    Path best;
+    bool first = true;
+    for (auto t = succ[v].begin(); t != succ[v].end(); ++t)
+    {
+        longer(best, edge(*t, scope), first);
+        first = false;
+    }
+    best.cost += 1;
+    if (callee[v] >= 0)
+    {
+        Path call = longest(callee[v], -1);
+        best.cost += call.cost;
+        if (!best.unbounded)
+            best.unbounded = call.unbounded;
+    }
+
+    busy.erase(key);
+    memo[key] = best;
+    return best;
+}
+
+/*
+  Show the cycles of every instruction, and of every basic block, in the listing
+  */
+static void annotate(Timing &t, std::map<int, std::string> &cycles)
+{
+    program::Code &c = t.c;
+    int count = t.count;
+    long long each = getWorstCycles(c.process, 1);
+
+    std::vector<bool> leader(count, false);
+    for (int i = 0; i < count; i++)
+    {
+        if (i == 0 || t.mark[i] >= 0)
+            leader[i] = true;
+        if (t.callee[i] >= 0)
+            leader[t.callee[i]] = true;
+        bool straight = t.callee[i] < 0 && t.succ[i].size() == 1 && t.succ[i][0] == i + 1;
+        for (auto s = t.succ[i].begin(); s != t.succ[i].end() && !straight; ++s)
+        {
+            if (*s < count)
+                leader[*s] = true;
+        }
+        if (!straight && i + 1 < count)
+            leader[i + 1] = true;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        std::stringstream s;
+        s << std::setw(4) << each;
+        if (leader[i])
+        {
+            int size = 1;
+            while (i + size < count && !leader[i + size])
+                size++;
+            s << std::setw(8) << "=" + std::to_string(getWorstCycles(c.process, size));
+        }
+        else
+            s << "        ";
+        cycles[c.nodes[i].ins] = s.str();
+    }
+}
+
+void analyse()
+{
+    sections.clear();
+    std::map<int, std::string> cycles;
+    dataflow::scan();
+    for (auto c = program::code.begin(); c != program::code.end(); ++c)
+    {
+        if (c->nodes.empty())
+            continue;
+        dataflow::Analysis a(*c);
+        a.run();
+        Timing t(a);
+        annotate(t, cycles);
+
+        for (int i = 0; i < t.count; i++)
+        {
+            if (t.mark[i] < 0)
+                continue;
+            Path p = t.longest(i, -1);
+            Section s;
+            s.process = c->name;
+            s.from = data::data.hints[t.mark[i]].line_number;
+            s.to = p.end >= 0 ? data::data.hints[t.mark[p.end]].line_number : p.end;
+            s.instructions = p.cost;
+            s.cycles = getWorstCycles(c->process, p.cost);
+            s.unbounded = p.unbounded;
+            sections.push_back(s);
+        }
+    }
+
+    std::vector<ListingLine> &listing = data::data.getListing();
+    for (auto l = listing.begin(); l != listing.end(); ++l)
+    {
+        for (auto e = l->inserted.begin(); e != l->inserted.end(); ++e)
+        {
+            if (e->kind == LISTING_INSTRUCTION && cycles.count(e->location))
+                e->cycles = cycles[e->location];
+        }
+        if (l->main.kind == LISTING_INSTRUCTION && cycles.count(l->main.location))
+            l->main.cycles = cycles[l->main.location];
+    }
+}
+
+void printReport()
+{
+    std::cout << "wcet " << sections.size() << " marked sections" << std::endl;
+    for (auto s = sections.begin(); s != sections.end(); ++s)
+    {
+        std::cout << "  " << s->process << " line " << s->from << " to ";
+        if (s->to == END_RETURN)
+            std::cout << "a return";
+        else if (s->to == END_LOOP)
+            std::cout << "a loop that never ends";
+        else if (s->to == END_PROCESS)
+            std::cout << "the end of the process";
+        else
+            std::cout << "line " << s->to;
+        if (s->unbounded)
+            std::cout << ", no bound for the loop at line " << s->unbounded << std::endl;
+        else
+            std::cout << ", " << s->instructions << " instructions, " << s->cycles << " cycles" << std::endl;
+    }
+}
+
+} // namespace wcet
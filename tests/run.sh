@@ -0,0 +1,33 @@
+#!/bin/sh
+#
+# Regression tests, run with make check. Each program in tests is assembled as it is 
+# and with the optimiser, run in the simulator, and the values it writes to port 
+# 0x100 are compared with the .out file of the same name.
+
+ASM=$(pwd)/build/avasm
+SIM=$(pwd)/build/avsim
+TESTS=$(pwd)/tests
+WORK=$(mktemp -d)
+FAILED=0
+
+for test in "$TESTS"/*.s; do
+    name=$(basename "$test" .s)
+    for options in "" "-O" "-O -H -U 64 -I 8"; do
+        cp "$test" "$WORK/$name.s"
+        if ! (cd "$WORK" && "$ASM" -q $options "$name.s" && "$SIM" -q -n 10000 -x "$TESTS/ports" > "$name.txt"); then
+            echo "FAIL $name $options, did not build or run"
+            FAILED=1
+            continue
+        fi
+        awk '{print $6}' "$WORK/$name.txt" | diff -q - "$TESTS/$name.out" > /dev/null || {
+            echo "FAIL $name $options"
+            FAILED=1
+        }
+    done
+done
+
+rm -rf "$WORK"
+if [ $FAILED -eq 0 ]; then
+    echo "all tests passed"
+fi
+exit $FAILED
@@ -0,0 +1,39 @@
+; The first ldi looks dead because of the second, and the second looks like it loads
+; a value x already holds because of the first. Only one of them may be removed by -O.
+
+.reg zero 0
+.reg one 1
+.reg minusone 0xffff
+
+process P1
+.reg x
+.reg port 0x100
+		ldi x, 5
+		ldi x, 5
+		mov (port), x
+end:	jmp end
+endprocess
+
+process P2
+end:	jmp end
+endprocess
+
+process P3
+end:	jmp end
+endprocess
+
+process P4
+end:	jmp end
+endprocess
+
+process P5
+end:	jmp end
+endprocess
+
+process P6
+end:	jmp end
+endprocess
+
+process P7
+end:	jmp end
+endprocess
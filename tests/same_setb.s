@@ -0,0 +1,40 @@
+; The setb looks dead because of the mov, and the mov looks like it writes a value x 
+; already holds because of the setb. Only one of them may be removed by -O.
+
+.reg zero 0
+.reg one 1
+.reg minusone 0xffff
+
+process P1
+.reg x
+.reg a 3
+.reg port 0x100
+		setb x, 1, a
+		mov x, a
+		mov (port), x
+end:	jmp end
+endprocess
+
+process P2
+end:	jmp end
+endprocess
+
+process P3
+end:	jmp end
+endprocess
+
+process P4
+end:	jmp end
+endprocess
+
+process P5
+end:	jmp end
+endprocess
+
+process P6
+end:	jmp end
+endprocess
+
+process P7
+end:	jmp end
+endprocess